@@ -41,6 +41,12 @@ module Yast
 
       StorageCallbacks.ProgressBar("Storage::test_log_progress")
 
+      # // alternatively register a Ruby callable directly
+      # StorageCallbacks.EnableRubyCallbacks
+      # StorageRubyCallbacks.progress_bar(lambda { |id, cur, max|
+      #   Builtins.y2milestone("IN RUBY %1 %2 %3", id, cur, max)
+      # })
+
       @o.setRecursiveRemoval(true)
 
       @disk = "/dev/sdb"
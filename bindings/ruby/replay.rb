@@ -0,0 +1,84 @@
+# encoding: utf-8
+
+# Copyright (c) 2016 SUSE LLC
+#
+# All Rights Reserved.
+#
+# This program is free software; you can redistribute it and/or modify it
+# under the terms of version 2 of the GNU General Public License as published
+# by the Free Software Foundation.
+#
+# This program is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+# more details.
+#
+# You should have received a copy of the GNU General Public License along
+# with this program; if not, contact SUSE LLC.
+#
+# To contact SUSE about this file by physical or electronic mail, you may
+# find current contact information at www.suse.com.
+
+# Replays a callback log recorded with YAST2_STORAGE_RECORD_CALLBACKS.
+#
+# /usr/lib/YaST2/bin/y2base ./replay.rb '("callbacks.log", "realtime")' stdio
+#
+# Without "realtime" the callbacks are replayed as fast as possible. With
+# "ui" the StorageClients handlers are used, otherwise handlers that only
+# count the calls and give the recorded default answers.
+
+require "storage"
+
+module Yast
+  class ReplayClient < Client
+    def main
+      Yast.import "StorageCallbacks"
+      Yast.import "StorageClients"
+
+      args = WFM.Args
+      file = args.fetch(0, "callbacks.log")
+      realtime = args.include?("realtime")
+
+      if args.include?("ui")
+        # the commit error popup asks libstorage for the error text
+        env = ::Storage::Environment.new(true)
+        sint = ::Storage::createStorageInterface(env)
+        StorageClients.InstallCallbacks(sint)
+      else
+        install_counting_callbacks
+      end
+
+      start = ::Time.now
+      ret = StorageCallbacks.Replay(file, realtime)
+      Builtins.y2milestone("Replay ret: %1 time: %2 s", ret, ::Time.now - start)
+      Builtins.y2milestone("counts: %1", @counts) if @counts
+
+      ::Storage::destroyStorageInterface(sint) if sint
+
+      nil
+    end
+
+    def install_counting_callbacks
+      @counts = Hash.new(0)
+
+      StorageCallbacks.EnableRubyCallbacks
+      StorageRubyCallbacks.progress_bar(lambda { |id, cur, max| @counts[:progress_bar] += 1 })
+      StorageRubyCallbacks.show_install_info(lambda { |text| @counts[:show_install_info] += 1 })
+      StorageRubyCallbacks.info_popup(lambda { |text| @counts[:info_popup] += 1 })
+      StorageRubyCallbacks.yesno_popup(lambda do |text|
+        @counts[:yesno_popup] += 1
+        true
+      end)
+      StorageRubyCallbacks.commit_error_popup(lambda do |error, last_action, extended_message|
+        @counts[:commit_error_popup] += 1
+        false
+      end)
+      StorageRubyCallbacks.password_popup(lambda do |device, attempts, password|
+        @counts[:password_popup] += 1
+        [false, ""]
+      end)
+    end
+  end
+end
+
+Yast::ReplayClient.new.main
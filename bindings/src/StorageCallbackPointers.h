@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2016 SUSE LLC
+ *
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of version 2 of the GNU General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, contact SUSE LLC.
+ *
+ * To contact SUSE about this file by physical or electronic mail, you may
+ * find current contact information at www.suse.com.
+ */
+
+/*
+   File:	StorageCallbackPointers.h
+
+   Purpose:	The callback pointers libstorage calls, shared by the YCP
+		and Ruby callbacks and the recorder
+/-*/
+
+#ifndef StorageCallbackPointers_h
+#define StorageCallbackPointers_h
+
+#include <storage/StorageInterface.h>
+
+namespace storage
+{
+    // workaround for broken YCP bindings
+    extern CallbackProgressBar progress_bar_cb_ycp;
+    extern CallbackShowInstallInfo install_info_cb_ycp;
+    extern CallbackInfoPopup info_popup_cb_ycp;
+    extern CallbackYesNoPopup yesno_popup_cb_ycp;
+    extern CallbackCommitErrorPopup commit_error_popup_cb_ycp;
+    extern CallbackPasswordPopup password_popup_cb_ycp;
+}
+
+#endif // StorageCallbackPointers_h
@@ -49,6 +49,10 @@
 #include <ycp/YExpression.h>
 #include <ycp/YBlock.h>
 #include "StorageCallbacks.h"
+#include "StorageRubyCallbacks.h"
+#include "StorageTrace.h"
+#include "StorageRecorder.h"
+#include "StorageMemory.h"
 
 #include <ycp/YCPInteger.h>
 #include <ycp/YCPString.h>
@@ -61,16 +65,7 @@
 
 #include <storage/StorageInterface.h>
 
-namespace storage
-{
-    // workaround for broken YCP bindings
-    extern CallbackProgressBar progress_bar_cb_ycp;
-    extern CallbackShowInstallInfo install_info_cb_ycp;
-    extern CallbackInfoPopup info_popup_cb_ycp;
-    extern CallbackYesNoPopup yesno_popup_cb_ycp; 
-    extern CallbackCommitErrorPopup commit_error_popup_cb_ycp;
-    extern CallbackPasswordPopup password_popup_cb_ycp;
-}
+#include "StorageCallbackPointers.h"
 
 
 class Y2StorageCallbackFunction : public Y2Function
@@ -239,6 +234,9 @@ static Y2Function* password_popup = NULL;
 
 void progress_bar_callback( const string& id, unsigned cur, unsigned max )
 {
+    StorageTraceSpan span ("ProgressBar", "callback");
+    StorageRecorder::progress_bar (StorageRecorder::now (), id, cur, max);
+
     if (progress_bar)
     {
 	progress_bar->reset ();
@@ -252,6 +250,10 @@ void progress_bar_callback( const string& id, unsigned cur, unsigned max )
 
 void show_install_info_callback( const string& id )
 {
+    StorageTrace::action (id);
+    StorageTraceSpan span ("ShowInstallInfo", "callback");
+    StorageRecorder::show_install_info (StorageRecorder::now (), id);
+
     if (show_install_info)
     {
 	show_install_info->reset ();
@@ -263,6 +265,9 @@ void show_install_info_callback( const string& id )
 
 void info_popup_callback( const string& text )
 {
+    StorageTraceSpan span ("InfoPopup", "callback");
+    StorageRecorder::info_popup (StorageRecorder::now (), text);
+
     if (info_popup)
     {
 	info_popup->reset ();
@@ -274,6 +279,9 @@ void info_popup_callback( const string& text )
 
 bool yesno_popup_callback( const string& text )
 {
+    StorageTraceSpan span ("YesNoPopup", "callback");
+    unsigned long long ts = StorageRecorder::now ();
+
     bool ret = false;
 
     if (yesno_popup)
@@ -287,12 +295,17 @@ bool yesno_popup_callback( const string& text )
             ret = tmp->asBoolean()->value();
     }
 
+    StorageRecorder::yesno_popup (ts, text, ret);
+
     return ret;
 }
 
 
 bool commit_error_popup_callback(int error, const string& last_action, const string& extended_message)
 {
+    StorageTraceSpan span("CommitErrorPopup", "callback");
+    unsigned long long ts = StorageRecorder::now();
+
     bool ret = false;
 
     if (commit_error_popup)
@@ -308,12 +321,17 @@ bool commit_error_popup_callback(int error, const string& last_action, const str
             ret = tmp->asBoolean()->value();
     }
 
+    StorageRecorder::commit_error_popup(ts, error, last_action, extended_message, ret);
+
     return ret;
 }
 
 
 bool password_popup_callback(const string& device, int attempts, string& password)
 {
+    StorageTraceSpan span("PasswordPopup", "callback");
+    unsigned long long ts = StorageRecorder::now();
+
     bool ret = false;
 
     if (password_popup)
@@ -331,6 +349,8 @@ bool password_popup_callback(const string& device, int attempts, string& passwor
 	password = tmp2->value(1)->asString()->value();	
     }
 
+    StorageRecorder::password_popup(ts, device, attempts, ret);
+
     return ret;
 }
 
@@ -613,6 +633,98 @@ StorageCallbacks::PasswordPopup (const YCPString & callback)
     return YCPVoid ();
 }
 
+YCPValue
+StorageCallbacks::EnableRubyCallbacks ()
+{
+    y2debug ("Enabling Ruby callbacks");
+
+    init_ruby_callbacks ();
+
+    return YCPVoid ();
+}
+
+YCPValue
+StorageCallbacks::StartTrace (const YCPString & filename)
+{
+    StorageTrace::start (filename->value ());
+
+    return YCPVoid ();
+}
+
+YCPValue
+StorageCallbacks::StopTrace ()
+{
+    return YCPBoolean (StorageTrace::stop ());
+}
+
+YCPValue
+StorageCallbacks::TraceBegin (const YCPString & name)
+{
+    StorageTrace::begin (name->value (), "hook");
+
+    return YCPVoid ();
+}
+
+YCPValue
+StorageCallbacks::TraceEnd (const YCPString & name)
+{
+    StorageTrace::end (name->value (), "hook");
+
+    return YCPVoid ();
+}
+
+YCPValue
+StorageCallbacks::TraceEndAction ()
+{
+    StorageTrace::end_action ();
+
+    return YCPVoid ();
+}
+
+YCPValue
+StorageCallbacks::StartRecording (const YCPString & filename)
+{
+    return YCPBoolean (StorageRecorder::start (filename->value ()));
+}
+
+YCPValue
+StorageCallbacks::StopRecording ()
+{
+    return YCPBoolean (StorageRecorder::stop ());
+}
+
+YCPValue
+StorageCallbacks::Replay (const YCPString & filename, const YCPBoolean & realtime)
+{
+    StorageRecorder::Stats stats;
+    bool ok = StorageRecorder::replay (filename->value (), realtime->value (), stats);
+
+    YCPMap ret;
+    ret->add (YCPString ("ok"), YCPBoolean (ok));
+    ret->add (YCPString ("callbacks"), YCPInteger (stats.callbacks));
+    ret->add (YCPString ("mismatches"), YCPInteger (stats.mismatches));
+    return ret;
+}
+
+YCPValue
+StorageCallbacks::AccountMemory (const YCPString & category, const YCPInteger & bytes)
+{
+    StorageMemory::account (category->value (), bytes->value ());
+
+    return YCPVoid ();
+}
+
+YCPValue
+StorageCallbacks::MemoryUsage ()
+{
+    map<string, long long> usage = StorageMemory::usage ();
+
+    YCPMap ret;
+    for (map<string, long long>::const_iterator it = usage.begin (); it != usage.end (); ++it)
+	ret->add (YCPString (it->first), YCPInteger (it->second));
+    return ret;
+}
+
 void
 log_do( int level, const string& component, const char* file, int line, const char* func,
         const string& text)
@@ -63,6 +63,37 @@ public:
     /* TYPEINFO: void(string) */
     YCPValue PasswordPopup (const YCPString& func);
 
+    // defines Yast::StorageRubyCallbacks for registering Ruby callables,
+    // must only be called from Ruby
+    /* TYPEINFO: void() */
+    YCPValue EnableRubyCallbacks ();
+
+    // tracing of callbacks, commit actions and hooks, see StorageTrace.h
+    /* TYPEINFO: void(string) */
+    YCPValue StartTrace (const YCPString& filename);
+    /* TYPEINFO: boolean() */
+    YCPValue StopTrace ();
+    /* TYPEINFO: void(string) */
+    YCPValue TraceBegin (const YCPString& name);
+    /* TYPEINFO: void(string) */
+    YCPValue TraceEnd (const YCPString& name);
+    /* TYPEINFO: void() */
+    YCPValue TraceEndAction ();
+
+    // recording and replaying of callbacks, see StorageRecorder.h
+    /* TYPEINFO: boolean(string) */
+    YCPValue StartRecording (const YCPString& filename);
+    /* TYPEINFO: boolean() */
+    YCPValue StopRecording ();
+    /* TYPEINFO: map<string,any>(string,boolean) */
+    YCPValue Replay (const YCPString& filename, const YCPBoolean& realtime);
+
+    // accounting of memory held by cached data, see StorageMemory.h
+    /* TYPEINFO: void(string,integer) */
+    YCPValue AccountMemory (const YCPString& category, const YCPInteger& bytes);
+    /* TYPEINFO: map<string,integer>() */
+    YCPValue MemoryUsage ();
+
     /**
      * Constructor.
      */
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2016 SUSE LLC
+ *
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of version 2 of the GNU General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, contact SUSE LLC.
+ *
+ * To contact SUSE about this file by physical or electronic mail, you may
+ * find current contact information at www.suse.com.
+ */
+
+/*
+   File:	StorageMemory.cc
+
+   Summary:	Accounting of memory held by cached storage data
+/-*/
+
+#define y2log_component "libstorage"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <ycp/y2log.h>
+
+#include "StorageMemory.h"
+
+
+map<string, long long> StorageMemory::categories;
+
+
+// reads a "VmRSS:    1234 kB" style line from /proc/self/status
+static long long
+proc_status_bytes(const char* key)
+{
+    FILE* f = fopen("/proc/self/status", "r");
+    if (!f)
+	return -1;
+
+    long long ret = -1;
+    size_t len = strlen(key);
+    char line[256];
+    while (fgets(line, sizeof(line), f))
+    {
+	if (strncmp(line, key, len) == 0 && line[len] == ':')
+	{
+	    long long kb;
+	    if (sscanf(line + len + 1, "%lld", &kb) == 1)
+		ret = kb * 1024;
+	    break;
+	}
+    }
+
+    fclose(f);
+    return ret;
+}
+
+
+void
+StorageMemory::account(const string& category, long long bytes)
+{
+    if (bytes > 0)
+	categories[category] = bytes;
+    else
+	categories.erase(category);
+
+    y2debug("memory %s: %lld bytes", category.c_str(), bytes);
+}
+
+
+map<string, long long>
+StorageMemory::usage()
+{
+    map<string, long long> ret = categories;
+
+    long long total = 0;
+    for (map<string, long long>::const_iterator it = categories.begin();
+	 it != categories.end(); ++it)
+	total += it->second;
+
+    ret["total"] = total;
+    ret["process_rss"] = proc_status_bytes("VmRSS");
+    ret["process_hwm"] = proc_status_bytes("VmHWM");
+
+    return ret;
+}
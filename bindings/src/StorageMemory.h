@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2016 SUSE LLC
+ *
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of version 2 of the GNU General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, contact SUSE LLC.
+ *
+ * To contact SUSE about this file by physical or electronic mail, you may
+ * find current contact information at www.suse.com.
+ */
+
+/*
+   File:	StorageMemory.h
+
+   Purpose:	Accounting of memory held by cached storage data (backup
+		states, target map, free space info) next to the memory
+		usage of the process
+/-*/
+
+#ifndef StorageMemory_h
+#define StorageMemory_h
+
+#include <string>
+#include <map>
+
+using std::string;
+using std::map;
+
+
+class StorageMemory
+{
+public:
+
+    /**
+     * Sets the number of bytes currently held by a category, e.g.
+     * "backup:initial" or "target_map". The numbers are reported by the
+     * callers and are estimates. Zero bytes removes the category.
+     */
+    static void account(const string& category, long long bytes);
+
+    /**
+     * Returns the accounted categories together with their sum as "total"
+     * and the resident set size and its peak of the process as
+     * "process_rss" and "process_hwm" (bytes, -1 if unknown).
+     */
+    static map<string, long long> usage();
+
+private:
+
+    static map<string, long long> categories;
+
+};
+
+#endif // StorageMemory_h
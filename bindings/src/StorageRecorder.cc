@@ -0,0 +1,462 @@
+/*
+ * Copyright (c) 2016 SUSE LLC
+ *
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of version 2 of the GNU General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, contact SUSE LLC.
+ *
+ * To contact SUSE about this file by physical or electronic mail, you may
+ * find current contact information at www.suse.com.
+ */
+
+/*
+   File:	StorageRecorder.cc
+
+   Summary:	Recording and replaying of the libstorage callbacks
+/-*/
+
+#define y2log_component "libstorage"
+
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include <ycp/y2log.h>
+
+#include "StorageRecorder.h"
+#include "StorageCallbackPointers.h"
+
+
+static const char magic[4] = { 'Y', 'S', 'C', 'B' };
+static const unsigned char version = 1;
+
+
+FILE* StorageRecorder::file = NULL;
+string StorageRecorder::filename;
+unsigned long long StorageRecorder::start_time = 0;
+
+
+static unsigned long long
+monotonic_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+
+namespace
+{
+
+    // callbacks may come from several threads, so every record is written
+    // and the file is switched with the mutex locked
+    pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+
+    class Lock
+    {
+    public:
+
+	Lock() { pthread_mutex_lock(&mutex); }
+	~Lock() { pthread_mutex_unlock(&mutex); }
+
+    };
+
+
+    void
+    write_u8(FILE* f, unsigned char v)
+    {
+	fwrite(&v, sizeof(v), 1, f);
+    }
+
+    void
+    write_i32(FILE* f, int32_t v)
+    {
+	fwrite(&v, sizeof(v), 1, f);
+    }
+
+    void
+    write_u64(FILE* f, uint64_t v)
+    {
+	fwrite(&v, sizeof(v), 1, f);
+    }
+
+    void
+    write_string(FILE* f, const string& s)
+    {
+	uint32_t len = s.size();
+	fwrite(&len, sizeof(len), 1, f);
+	fwrite(s.data(), 1, len, f);
+    }
+
+
+    bool
+    read_u8(FILE* f, unsigned char& v)
+    {
+	return fread(&v, sizeof(v), 1, f) == 1;
+    }
+
+    bool
+    read_i32(FILE* f, int& v)
+    {
+	int32_t tmp;
+	if (fread(&tmp, sizeof(tmp), 1, f) != 1)
+	    return false;
+	v = tmp;
+	return true;
+    }
+
+    bool
+    read_u64(FILE* f, unsigned long long& v)
+    {
+	uint64_t tmp;
+	if (fread(&tmp, sizeof(tmp), 1, f) != 1)
+	    return false;
+	v = tmp;
+	return true;
+    }
+
+    // bytes left to read, used to reject corrupt string lengths before
+    // allocating them
+    long
+    remaining(FILE* f)
+    {
+	struct stat st;
+	long pos = ftell(f);
+	if (pos < 0 || fstat(fileno(f), &st) != 0)
+	    return -1;
+	return st.st_size - pos;
+    }
+
+    bool
+    read_string(FILE* f, string& s)
+    {
+	uint32_t len;
+	if (fread(&len, sizeof(len), 1, f) != 1)
+	    return false;
+	long left = remaining(f);
+	if (left < 0 || len > (unsigned long) left)
+	    return false;
+	s.resize(len);
+	return len == 0 || fread(&s[0], 1, len, f) == len;
+    }
+
+}
+
+
+bool
+StorageRecorder::start(const string& filename_r)
+{
+    Lock lock;
+
+    close();
+
+    // continue a log started before in this process, the times of the
+    // records stay relative to its start
+    bool append = !filename.empty() && filename == filename_r;
+
+    file = fopen(filename_r.c_str(), append ? "a" : "w");
+    if (!file)
+    {
+	y2error("failed to open callback log %s", filename_r.c_str());
+	return false;
+    }
+
+    y2milestone("recording callbacks to %s append:%d", filename_r.c_str(), append);
+
+    if (!append)
+    {
+	fwrite(magic, sizeof(magic), 1, file);
+	write_u8(file, version);
+
+	filename = filename_r;
+	start_time = monotonic_us();
+    }
+
+    return true;
+}
+
+
+bool
+StorageRecorder::stop()
+{
+    Lock lock;
+
+    return close();
+}
+
+
+bool
+StorageRecorder::close()
+{
+    if (!file)
+	return false;
+
+    bool ok = fclose(file) == 0;
+    file = NULL;
+
+    return ok;
+}
+
+
+unsigned long long
+StorageRecorder::now()
+{
+    Lock lock;
+
+    return file ? monotonic_us() - start_time : 0;
+}
+
+
+void
+StorageRecorder::write_header(unsigned char type, unsigned long long ts)
+{
+    write_u8(file, type);
+    write_u64(file, ts);
+}
+
+
+void
+StorageRecorder::progress_bar(unsigned long long ts, const string& id, unsigned cur,
+			      unsigned max)
+{
+    Lock lock;
+
+    if (!file)
+	return;
+
+    write_header(PROGRESS_BAR, ts);
+    write_string(file, id);
+    write_i32(file, cur);
+    write_i32(file, max);
+}
+
+
+void
+StorageRecorder::show_install_info(unsigned long long ts, const string& id)
+{
+    Lock lock;
+
+    if (!file)
+	return;
+
+    write_header(SHOW_INSTALL_INFO, ts);
+    write_string(file, id);
+}
+
+
+void
+StorageRecorder::info_popup(unsigned long long ts, const string& text)
+{
+    Lock lock;
+
+    if (!file)
+	return;
+
+    write_header(INFO_POPUP, ts);
+    write_string(file, text);
+}
+
+
+void
+StorageRecorder::yesno_popup(unsigned long long ts, const string& text, bool ret)
+{
+    Lock lock;
+
+    if (!file)
+	return;
+
+    write_header(YESNO_POPUP, ts);
+    write_string(file, text);
+    write_u8(file, ret);
+}
+
+
+void
+StorageRecorder::commit_error_popup(unsigned long long ts, int error, const string& last_action,
+				    const string& extended_message, bool ret)
+{
+    Lock lock;
+
+    if (!file)
+	return;
+
+    write_header(COMMIT_ERROR_POPUP, ts);
+    write_i32(file, error);
+    write_string(file, last_action);
+    write_string(file, extended_message);
+    write_u8(file, ret);
+}
+
+
+void
+StorageRecorder::password_popup(unsigned long long ts, const string& device, int attempts,
+				bool ret)
+{
+    Lock lock;
+
+    if (!file)
+	return;
+
+    write_header(PASSWORD_POPUP, ts);
+    write_string(file, device);
+    write_i32(file, attempts);
+    write_u8(file, ret);
+}
+
+
+bool
+StorageRecorder::replay(const string& filename, bool realtime, Stats& stats)
+{
+    FILE* f = fopen(filename.c_str(), "r");
+    if (!f)
+    {
+	y2error("failed to open callback log %s", filename.c_str());
+	return false;
+    }
+
+    char tmp_magic[sizeof(magic)];
+    unsigned char tmp_version;
+    if (fread(tmp_magic, sizeof(tmp_magic), 1, f) != 1 || memcmp(tmp_magic, magic, sizeof(magic)) != 0 ||
+	!read_u8(f, tmp_version) || tmp_version != version)
+    {
+	y2error("%s is not a callback log", filename.c_str());
+	fclose(f);
+	return false;
+    }
+
+    y2milestone("replaying callbacks from %s realtime:%d", filename.c_str(), realtime);
+
+    // the replayed callbacks must not end up in a running recording, the
+    // lock cannot be held during the replay since the callbacks record
+    FILE* recording;
+    {
+	Lock lock;
+	recording = file;
+	file = NULL;
+    }
+
+    unsigned long long replay_start = monotonic_us();
+    bool ok = true;
+
+    unsigned char type;
+    unsigned long long ts;
+    while (read_u8(f, type))
+    {
+	if (!read_u64(f, ts))
+	{
+	    ok = false;
+	    break;
+	}
+
+	if (realtime)
+	{
+	    unsigned long long elapsed = monotonic_us() - replay_start;
+	    if (ts > elapsed)
+		usleep(ts - elapsed);
+	}
+
+	string s1, s2;
+	int i1 = 0, i2 = 0;
+	unsigned char ret = 0;
+
+	switch (type)
+	{
+	    case PROGRESS_BAR:
+		ok = read_string(f, s1) && read_i32(f, i1) && read_i32(f, i2);
+		if (ok && storage::progress_bar_cb_ycp)
+		{
+		    storage::progress_bar_cb_ycp(s1, i1, i2);
+		    stats.callbacks++;
+		}
+		break;
+
+	    case SHOW_INSTALL_INFO:
+		ok = read_string(f, s1);
+		if (ok && storage::install_info_cb_ycp)
+		{
+		    storage::install_info_cb_ycp(s1);
+		    stats.callbacks++;
+		}
+		break;
+
+	    case INFO_POPUP:
+		ok = read_string(f, s1);
+		if (ok && storage::info_popup_cb_ycp)
+		{
+		    storage::info_popup_cb_ycp(s1);
+		    stats.callbacks++;
+		}
+		break;
+
+	    case YESNO_POPUP:
+		ok = read_string(f, s1) && read_u8(f, ret);
+		if (ok && storage::yesno_popup_cb_ycp)
+		{
+		    if (storage::yesno_popup_cb_ycp(s1) != (ret != 0))
+			stats.mismatches++;
+		    stats.callbacks++;
+		}
+		break;
+
+	    case COMMIT_ERROR_POPUP:
+		ok = read_i32(f, i1) && read_string(f, s1) && read_string(f, s2) && read_u8(f, ret);
+		if (ok && storage::commit_error_popup_cb_ycp)
+		{
+		    if (storage::commit_error_popup_cb_ycp(i1, s1, s2) != (ret != 0))
+			stats.mismatches++;
+		    stats.callbacks++;
+		}
+		break;
+
+	    case PASSWORD_POPUP:
+		ok = read_string(f, s1) && read_i32(f, i1) && read_u8(f, ret);
+		if (ok && storage::password_popup_cb_ycp)
+		{
+		    string password;
+		    if (storage::password_popup_cb_ycp(s1, i1, password) != (ret != 0))
+			stats.mismatches++;
+		    stats.callbacks++;
+		}
+		break;
+
+	    default:
+		y2error("unknown callback type %d", type);
+		ok = false;
+	}
+
+	if (!ok)
+	    break;
+    }
+
+    fclose(f);
+
+    {
+	Lock lock;
+	// a recording started during the replay wins
+	if (!file)
+	    file = recording;
+	else if (recording)
+	    fclose(recording);
+    }
+
+    if (!ok)
+	y2error("callback log %s is truncated or corrupt", filename.c_str());
+
+    y2milestone("replayed %u callbacks with %u mismatches in %llu us", stats.callbacks,
+		stats.mismatches, monotonic_us() - replay_start);
+
+    return ok;
+}
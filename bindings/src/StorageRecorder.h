@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2016 SUSE LLC
+ *
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of version 2 of the GNU General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, contact SUSE LLC.
+ *
+ * To contact SUSE about this file by physical or electronic mail, you may
+ * find current contact information at www.suse.com.
+ */
+
+/*
+   File:	StorageRecorder.h
+
+   Purpose:	Recording of the libstorage callbacks to a binary log and
+		replaying the log into the registered callbacks
+
+   The log starts with the magic "YSCB" and a version byte followed by the
+   records. Each record has the callback type (one byte), the time since
+   the start of the recording in microseconds (64 bit), the arguments and
+   the returned value, if any. Integers are in host byte order, strings are
+   stored as 32 bit length and the bytes.
+
+   Passwords are never written to the log, only whether one was entered.
+
+   Starting the recording again with the same file appends to it, so the
+   log covers the whole process even if libstorage is initialized several
+   times.
+/-*/
+
+#ifndef StorageRecorder_h
+#define StorageRecorder_h
+
+#include <stdio.h>
+#include <string>
+
+using std::string;
+
+
+class StorageRecorder
+{
+public:
+
+    struct Stats
+    {
+	Stats() : callbacks(0), mismatches(0) {}
+
+	unsigned callbacks;
+	unsigned mismatches;
+    };
+
+    static bool start(const string& filename);
+    static bool stop();
+
+    /**
+     * Time for the records. Taken before calling the callback so that
+     * replay happens at the time the original callback was started.
+     */
+    static unsigned long long now();
+
+    static void progress_bar(unsigned long long ts, const string& id, unsigned cur,
+			     unsigned max);
+    static void show_install_info(unsigned long long ts, const string& id);
+    static void info_popup(unsigned long long ts, const string& text);
+    static void yesno_popup(unsigned long long ts, const string& text, bool ret);
+    static void commit_error_popup(unsigned long long ts, int error, const string& last_action,
+				   const string& extended_message, bool ret);
+    static void password_popup(unsigned long long ts, const string& device, int attempts,
+			       bool ret);
+
+    /**
+     * Feeds the recorded callbacks to the currently registered callbacks,
+     * either at the recorded times or as fast as possible. Returned values
+     * that differ from the recorded ones are counted as mismatches.
+     */
+    static bool replay(const string& filename, bool realtime, Stats& stats);
+
+private:
+
+    enum Type
+    {
+	PROGRESS_BAR = 1, SHOW_INSTALL_INFO, INFO_POPUP, YESNO_POPUP,
+	COMMIT_ERROR_POPUP, PASSWORD_POPUP
+    };
+
+    // must be called with the mutex locked
+    static bool close();
+    static void write_header(unsigned char type, unsigned long long ts);
+
+    static FILE* file;
+    static string filename;
+    static unsigned long long start_time;
+
+};
+
+#endif // StorageRecorder_h
@@ -0,0 +1,330 @@
+/*
+ * Copyright (c) 2016 SUSE LLC
+ *
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of version 2 of the GNU General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, contact SUSE LLC.
+ *
+ * To contact SUSE about this file by physical or electronic mail, you may
+ * find current contact information at www.suse.com.
+ */
+
+/*
+   File:	StorageRubyCallbacks.cc
+
+   Summary:	Storage callbacks calling Ruby callables directly
+
+   The arguments are passed as Ruby values, so neither YCP values nor a
+   namespace lookup are needed per call. Exceptions raised by the callables
+   are logged and not propagated through libstorage.
+/-*/
+
+#define y2log_component "libstorage"
+
+#include <ruby.h>
+#include <ruby/encoding.h>
+
+#include <ycp/y2log.h>
+
+#include "StorageRubyCallbacks.h"
+#include "StorageTrace.h"
+#include "StorageRecorder.h"
+#include "StorageCallbackPointers.h"
+
+using std::string;
+
+
+namespace
+{
+
+    VALUE progress_bar = Qnil;
+    VALUE show_install_info = Qnil;
+    VALUE info_popup = Qnil;
+    VALUE yesno_popup = Qnil;
+    VALUE commit_error_popup = Qnil;
+    VALUE password_popup = Qnil;
+
+
+    /**
+     * An argument for a callable, either a string or an integer. The Ruby
+     * values are only created inside rb_protect since creating them can
+     * raise.
+     */
+    struct Arg
+    {
+	Arg(const string& s) : str(&s), num(0) {}
+	Arg(long num) : str(NULL), num(num) {}
+
+	const string* str;
+	long num;
+    };
+
+
+    struct Call
+    {
+	VALUE callable;
+	int argc;
+	const Arg* args;
+    };
+
+
+    VALUE
+    do_call(VALUE arg)
+    {
+	const Call* call = reinterpret_cast<const Call*>(arg);
+
+	VALUE argv[3];
+	for (int i = 0; i < call->argc; ++i)
+	{
+	    const Arg& a = call->args[i];
+	    argv[i] = a.str ? rb_enc_str_new(a.str->data(), a.str->size(), rb_utf8_encoding())
+		: LONG2NUM(a.num);
+	}
+
+	return rb_funcall2(call->callable, rb_intern("call"), call->argc, argv);
+    }
+
+
+    VALUE
+    do_message(VALUE exception)
+    {
+	return rb_String(rb_funcall(exception, rb_intern("message"), 0));
+    }
+
+
+    /**
+     * Calls callable with the arguments (at most three). Returns Qnil if the
+     * callable raised an exception.
+     */
+    VALUE
+    call_ruby(VALUE callable, int argc, const Arg* args)
+    {
+	Call call = { callable, argc, args };
+
+	int state = 0;
+	VALUE ret = rb_protect(do_call, reinterpret_cast<VALUE>(&call), &state);
+	if (state != 0)
+	{
+	    VALUE exception = rb_errinfo();
+	    rb_set_errinfo(Qnil);
+
+	    // the message method may raise as well
+	    VALUE message = rb_protect(do_message, exception, &state);
+	    if (state != 0)
+	    {
+		rb_set_errinfo(Qnil);
+		y2error("Ruby callback raised %s", rb_obj_classname(exception));
+	    }
+	    else
+	    {
+		y2error("Ruby callback raised %s: %s", rb_obj_classname(exception),
+			string(RSTRING_PTR(message), RSTRING_LEN(message)).c_str());
+	    }
+
+	    return Qnil;
+	}
+
+	return ret;
+    }
+
+
+    void
+    progress_bar_callback(const string& id, unsigned cur, unsigned max)
+    {
+	StorageTraceSpan span("ProgressBar", "callback");
+	StorageRecorder::progress_bar(StorageRecorder::now(), id, cur, max);
+
+	Arg args[] = { id, (long) cur, (long) max };
+	call_ruby(progress_bar, 3, args);
+    }
+
+
+    void
+    show_install_info_callback(const string& id)
+    {
+	StorageTrace::action(id);
+	StorageTraceSpan span("ShowInstallInfo", "callback");
+	StorageRecorder::show_install_info(StorageRecorder::now(), id);
+
+	Arg args[] = { id };
+	call_ruby(show_install_info, 1, args);
+    }
+
+
+    void
+    info_popup_callback(const string& text)
+    {
+	StorageTraceSpan span("InfoPopup", "callback");
+	StorageRecorder::info_popup(StorageRecorder::now(), text);
+
+	Arg args[] = { text };
+	call_ruby(info_popup, 1, args);
+    }
+
+
+    bool
+    yesno_popup_callback(const string& text)
+    {
+	StorageTraceSpan span("YesNoPopup", "callback");
+	unsigned long long ts = StorageRecorder::now();
+
+	Arg args[] = { text };
+	bool ret = RTEST(call_ruby(yesno_popup, 1, args));
+
+	StorageRecorder::yesno_popup(ts, text, ret);
+
+	return ret;
+    }
+
+
+    bool
+    commit_error_popup_callback(int error, const string& last_action,
+				const string& extended_message)
+    {
+	StorageTraceSpan span("CommitErrorPopup", "callback");
+	unsigned long long ts = StorageRecorder::now();
+
+	Arg args[] = { (long) error, last_action, extended_message };
+	bool ret = RTEST(call_ruby(commit_error_popup, 3, args));
+
+	StorageRecorder::commit_error_popup(ts, error, last_action, extended_message, ret);
+
+	return ret;
+    }
+
+
+    bool
+    password_popup_callback(const string& device, int attempts, string& password)
+    {
+	StorageTraceSpan span("PasswordPopup", "callback");
+	unsigned long long ts = StorageRecorder::now();
+
+	Arg args[] = { device, (long) attempts, password };
+	VALUE ret = call_ruby(password_popup, 3, args);
+
+	if (!RB_TYPE_P(ret, T_ARRAY) || RARRAY_LEN(ret) != 2)
+	{
+	    y2error("password callback must return [boolean, string]");
+	    StorageRecorder::password_popup(ts, device, attempts, false);
+	    return false;
+	}
+
+	VALUE tmp = rb_ary_entry(ret, 1);
+	if (RB_TYPE_P(tmp, T_STRING))
+	    password = string(RSTRING_PTR(tmp), RSTRING_LEN(tmp));
+
+	bool ok = RTEST(rb_ary_entry(ret, 0));
+
+	StorageRecorder::password_popup(ts, device, attempts, ok);
+
+	return ok;
+    }
+
+
+    void
+    check_callable(VALUE callable)
+    {
+	if (!NIL_P(callable) && !rb_respond_to(callable, rb_intern("call")))
+	    rb_raise(rb_eArgError, "storage callback must respond to call");
+    }
+
+
+    VALUE
+    set_progress_bar(VALUE self, VALUE callable)
+    {
+	check_callable(callable);
+	progress_bar = callable;
+	storage::progress_bar_cb_ycp = NIL_P(callable) ? NULL : progress_bar_callback;
+	return Qnil;
+    }
+
+
+    VALUE
+    set_show_install_info(VALUE self, VALUE callable)
+    {
+	check_callable(callable);
+	show_install_info = callable;
+	storage::install_info_cb_ycp = NIL_P(callable) ? NULL : show_install_info_callback;
+	return Qnil;
+    }
+
+
+    VALUE
+    set_info_popup(VALUE self, VALUE callable)
+    {
+	check_callable(callable);
+	info_popup = callable;
+	storage::info_popup_cb_ycp = NIL_P(callable) ? NULL : info_popup_callback;
+	return Qnil;
+    }
+
+
+    VALUE
+    set_yesno_popup(VALUE self, VALUE callable)
+    {
+	check_callable(callable);
+	yesno_popup = callable;
+	storage::yesno_popup_cb_ycp = NIL_P(callable) ? NULL : yesno_popup_callback;
+	return Qnil;
+    }
+
+
+    VALUE
+    set_commit_error_popup(VALUE self, VALUE callable)
+    {
+	check_callable(callable);
+	commit_error_popup = callable;
+	storage::commit_error_popup_cb_ycp = NIL_P(callable) ? NULL : commit_error_popup_callback;
+	return Qnil;
+    }
+
+
+    VALUE
+    set_password_popup(VALUE self, VALUE callable)
+    {
+	check_callable(callable);
+	password_popup = callable;
+	storage::password_popup_cb_ycp = NIL_P(callable) ? NULL : password_popup_callback;
+	return Qnil;
+    }
+
+}
+
+
+void
+init_ruby_callbacks()
+{
+    static bool initialized = false;
+
+    if (initialized)
+	return;
+
+    rb_gc_register_address(&progress_bar);
+    rb_gc_register_address(&show_install_info);
+    rb_gc_register_address(&info_popup);
+    rb_gc_register_address(&yesno_popup);
+    rb_gc_register_address(&commit_error_popup);
+    rb_gc_register_address(&password_popup);
+
+    VALUE yast = rb_define_module("Yast");
+    VALUE mod = rb_define_module_under(yast, "StorageRubyCallbacks");
+
+    rb_define_module_function(mod, "progress_bar", RUBY_METHOD_FUNC(set_progress_bar), 1);
+    rb_define_module_function(mod, "show_install_info", RUBY_METHOD_FUNC(set_show_install_info), 1);
+    rb_define_module_function(mod, "info_popup", RUBY_METHOD_FUNC(set_info_popup), 1);
+    rb_define_module_function(mod, "yesno_popup", RUBY_METHOD_FUNC(set_yesno_popup), 1);
+    rb_define_module_function(mod, "commit_error_popup", RUBY_METHOD_FUNC(set_commit_error_popup), 1);
+    rb_define_module_function(mod, "password_popup", RUBY_METHOD_FUNC(set_password_popup), 1);
+
+    initialized = true;
+}
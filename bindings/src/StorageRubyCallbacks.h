@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2016 SUSE LLC
+ *
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of version 2 of the GNU General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, contact SUSE LLC.
+ *
+ * To contact SUSE about this file by physical or electronic mail, you may
+ * find current contact information at www.suse.com.
+ */
+
+/*
+   File:	StorageRubyCallbacks.h
+
+   Purpose:	Storage callbacks calling Ruby callables directly, without
+		going through the YCP interpreter
+/-*/
+
+#ifndef StorageRubyCallbacks_h
+#define StorageRubyCallbacks_h
+
+/**
+ * Defines the Ruby module Yast::StorageRubyCallbacks. Its module functions
+ * (progress_bar, show_install_info, info_popup, yesno_popup,
+ * commit_error_popup and password_popup) take an object responding to call
+ * (e.g. a Proc or Method) or nil and install it as the libstorage callback.
+ *
+ * Must only be called from a Ruby thread.
+ */
+void init_ruby_callbacks();
+
+#endif // StorageRubyCallbacks_h
@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2016 SUSE LLC
+ *
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of version 2 of the GNU General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, contact SUSE LLC.
+ *
+ * To contact SUSE about this file by physical or electronic mail, you may
+ * find current contact information at www.suse.com.
+ */
+
+/*
+   File:	StorageTrace.cc
+
+   Summary:	Recording of begin/end spans in the Chrome trace-event format
+/-*/
+
+#define y2log_component "libstorage"
+
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+
+#include <ycp/y2log.h>
+
+#include "StorageTrace.h"
+
+
+bool StorageTrace::active = false;
+string StorageTrace::filename;
+string StorageTrace::current_action;
+vector<StorageTrace::Event> StorageTrace::events;
+
+
+namespace
+{
+
+    // callbacks may come from other threads than the hooks, so all access
+    // to the recorded events is serialized
+    pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+
+    class Lock
+    {
+    public:
+
+	Lock() { pthread_mutex_lock(&mutex); }
+	~Lock() { pthread_mutex_unlock(&mutex); }
+
+    };
+
+}
+
+
+static unsigned long long
+now_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+
+static void
+write_json_string(FILE* f, const string& s)
+{
+    fputc('"', f);
+    for (string::const_iterator it = s.begin(); it != s.end(); ++it)
+    {
+	unsigned char c = *it;
+	switch (c)
+	{
+	    case '"': fputs("\\\"", f); break;
+	    case '\\': fputs("\\\\", f); break;
+	    case '\n': fputs("\\n", f); break;
+	    case '\t': fputs("\\t", f); break;
+	    default:
+		if (c < 0x20)
+		    fprintf(f, "\\u%04x", c);
+		else
+		    fputc(c, f);
+	}
+    }
+    fputc('"', f);
+}
+
+
+bool
+StorageTrace::enabled()
+{
+    Lock lock;
+
+    return active;
+}
+
+
+void
+StorageTrace::start(const string& filename_r)
+{
+    y2milestone("starting trace to %s", filename_r.c_str());
+
+    Lock lock;
+
+    filename = filename_r;
+    current_action.clear();
+    events.clear();
+    active = true;
+}
+
+
+bool
+StorageTrace::stop()
+{
+    vector<Event> recorded;
+    string trace_file;
+
+    {
+	Lock lock;
+
+	if (!active)
+	    return false;
+
+	if (!current_action.empty())
+	    add(current_action, "action", 'E');
+	current_action.clear();
+
+	active = false;
+
+	recorded.swap(events);
+	trace_file = filename;
+    }
+
+    FILE* f = fopen(trace_file.c_str(), "w");
+    if (!f)
+    {
+	y2error("failed to open trace file %s", trace_file.c_str());
+	return false;
+    }
+
+    int pid = getpid();
+
+    fputs("{\"traceEvents\":[\n", f);
+    for (vector<Event>::const_iterator it = recorded.begin(); it != recorded.end(); ++it)
+    {
+	if (it != recorded.begin())
+	    fputs(",\n", f);
+	fputs("{\"name\":", f);
+	write_json_string(f, it->name);
+	fprintf(f, ",\"cat\":\"%s\",\"ph\":\"%c\",\"ts\":%llu,\"pid\":%d,\"tid\":%ld}",
+		it->category, it->phase, it->ts, pid, it->tid);
+    }
+    fputs("\n]}\n", f);
+
+    bool ok = fclose(f) == 0;
+
+    y2milestone("wrote %zu trace events to %s", recorded.size(), trace_file.c_str());
+
+    return ok;
+}
+
+
+// must be called with the mutex locked
+void
+StorageTrace::add(const string& name, const char* category, char phase)
+{
+    Event event = { name, category, phase, now_us(), syscall(SYS_gettid) };
+    events.push_back(event);
+}
+
+
+void
+StorageTrace::begin(const string& name, const char* category)
+{
+    Lock lock;
+
+    if (active)
+	add(name, category, 'B');
+}
+
+
+void
+StorageTrace::end(const string& name, const char* category)
+{
+    Lock lock;
+
+    if (active)
+	add(name, category, 'E');
+}
+
+
+void
+StorageTrace::action(const string& text)
+{
+    Lock lock;
+
+    if (!active)
+	return;
+
+    if (!current_action.empty())
+	add(current_action, "action", 'E');
+
+    current_action = text;
+    add(current_action, "action", 'B');
+}
+
+
+void
+StorageTrace::end_action()
+{
+    Lock lock;
+
+    if (active && !current_action.empty())
+	add(current_action, "action", 'E');
+
+    current_action.clear();
+}
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2016 SUSE LLC
+ *
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of version 2 of the GNU General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, contact SUSE LLC.
+ *
+ * To contact SUSE about this file by physical or electronic mail, you may
+ * find current contact information at www.suse.com.
+ */
+
+/*
+   File:	StorageTrace.h
+
+   Purpose:	Recording of begin/end spans in the Chrome trace-event
+		format (load the file in chrome://tracing)
+/-*/
+
+#ifndef StorageTrace_h
+#define StorageTrace_h
+
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+
+class StorageTrace
+{
+public:
+
+    static bool enabled();
+
+    /**
+     * Starts recording. Events recorded before are discarded.
+     */
+    static void start(const string& filename);
+
+    /**
+     * Stops recording and writes the trace file. Returns false if writing
+     * failed.
+     */
+    static bool stop();
+
+    static void begin(const string& name, const char* category);
+    static void end(const string& name, const char* category);
+
+    /**
+     * Ends the span of the current action, if any, and begins a new one.
+     * libstorage announces every commit action via the install info
+     * callback, so the actions are consecutive spans.
+     */
+    static void action(const string& text);
+
+    /**
+     * Ends the span of the current action, if any. Must be called when
+     * the commit is done, before the spans around it end.
+     */
+    static void end_action();
+
+private:
+
+    struct Event
+    {
+	string name;
+	const char* category;
+	char phase;
+	unsigned long long ts;
+	long tid;
+    };
+
+    static void add(const string& name, const char* category, char phase);
+
+    static bool active;
+    static string filename;
+    static string current_action;
+    static vector<Event> events;
+
+};
+
+
+/**
+ * Records a span for the lifetime of the object if tracing is enabled.
+ */
+class StorageTraceSpan
+{
+public:
+
+    StorageTraceSpan(const char* name, const char* category)
+	: name(name), category(category)
+    {
+	if (StorageTrace::enabled())
+	    StorageTrace::begin(name, category);
+    }
+
+    ~StorageTraceSpan()
+    {
+	if (StorageTrace::enabled())
+	    StorageTrace::end(name, category);
+    }
+
+private:
+
+    const char* name;
+    const char* category;
+
+};
+
+#endif // StorageTrace_h
@@ -33,6 +33,7 @@ BuildRequires:	libstorage-devel >= 2.25.36
 BuildRequires:	libstorage-ruby >= 2.25.36
 BuildRequires:	libxslt
 BuildRequires:	perl-XML-Writer
+BuildRequires:	ruby-devel
 BuildRequires:	rubygem(rspec)
 BuildRequires:	rubygem(ruby-dbus)
 BuildRequires:	sgml-skel
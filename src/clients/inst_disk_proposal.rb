@@ -223,7 +223,7 @@ module Yast
           return :abort if @ret == :abort && Popup.ReallyAbort(true)
 
           if @ret == :settings
-            if AskOverwriteChanges() && StorageProposal.CommonWidgetsPopup()
+            if AskOverwriteChanges() && StorageProposal.CommonWidgetsPopup(true)
               @target_is = "SUGGESTION"
               Storage.ResetOndiskTarget
               Storage.AddMountPointsForWin(Storage.GetTargetMap)
@@ -24,10 +24,48 @@
 # Summary:     Expert Partitioner
 # Authors:     Arvin Schnell <aschnell@suse.de>
 
+require "digest/md5"
+
 module Yast
   module PartitioningEpGraphInclude
     def initialize_partitioning_ep_graph(include_target)
       textdomain "storage"
+
+      # digest of the graph file currently shown, by kind of graph
+      @graph_digests = {}
+    end
+
+
+    # Lets libstorage save the device or mount graph and returns the
+    # filename and the digest of its content.
+    def GenerateGraph(kind)
+      filename = "#{Directory.tmpdir}/#{kind}.gv"
+      if kind == :device
+        Storage.SaveDeviceGraph(filename)
+      else
+        Storage.SaveMountGraph(filename)
+      end
+      content = Convert.to_string(SCR.Read(path(".target.string"), filename))
+      [filename, Digest::MD5.hexdigest(content || "")]
+    end
+
+
+    # Regenerates the graph and passes it to the graph widget only if it
+    # changed since the widget was last updated. Loading a file makes the
+    # widget lay out the whole graph again, which takes long for big graphs.
+    def RefreshGraph(kind)
+      filename, digest = GenerateGraph(kind)
+
+      if digest == @graph_digests[kind]
+        Builtins.y2milestone("RefreshGraph %1 unchanged", kind)
+      else
+        UI.ChangeWidget(Id(:graph), :Filename, filename)
+        @graph_digests[kind] = digest
+      end
+
+      SCR.Execute(path(".target.remove"), filename)
+
+      nil
     end
 
     def EpContextMenuDeviceGraph
@@ -58,8 +96,7 @@ module Yast
 
 
     def CreateDeviceGraphPanel(user_data)
-      filename = "#{Directory.tmpdir}/device.gv"
-      Storage.SaveDeviceGraph(filename)
+      filename, @graph_digests[:device] = GenerateGraph(:device)
 
       UI.ReplaceWidget(
         :tree_panel,
@@ -90,14 +127,7 @@ module Yast
 
 
     def RefreshDeviceGraphPanel(user_data)
-      filename = "#{Directory.tmpdir}/device.gv"
-      Storage.SaveDeviceGraph(filename)
-
-      UI.ChangeWidget(Id(:graph), :Filename, filename)
-
-      SCR.Execute(path(".target.remove"), filename)
-
-      nil
+      RefreshGraph(:device)
     end
 
 
@@ -147,8 +177,7 @@ module Yast
 
 
     def CreateMountGraphPanel(user_data)
-      filename = "#{Directory.tmpdir}/mount.gv"
-      Storage.SaveMountGraph(filename)
+      filename, @graph_digests[:mount] = GenerateGraph(:mount)
 
       UI.ReplaceWidget(
         :tree_panel,
@@ -179,14 +208,7 @@ module Yast
 
 
     def RefreshMountGraphPanel(user_data)
-      filename = "#{Directory.tmpdir}/mount.gv"
-      Storage.SaveMountGraph(filename)
-
-      UI.ChangeWidget(Id(:graph), :Filename, filename)
-
-      SCR.Execute(path(".target.remove"), filename)
-
-      nil
+      RefreshGraph(:mount)
     end
 
 
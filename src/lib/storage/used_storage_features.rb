@@ -168,8 +168,16 @@ module Yast
 
       def initialize(storage_interface = nil)
         @storage = storage_interface
+        # features of each volume and disk as [signature, feature set],
+        # recomputed only when the signature changes
+        @volume_features = {}
+        @disk_features = {}
+        # number of volumes and disks using each feature
+        @feature_counts = Hash.new(0)
       end
 
+      attr_reader :storage
+
       def init_lazy
         return if @storage
         env = ::Storage::Environment.new(true)
@@ -179,24 +187,126 @@ module Yast
       # Collect storage features and return a feature list
       # (a list containing :FT_xy symbols). The list may be empty.
       #
+      # The features of every device are remembered, so calling this again
+      # only checks devices that are new or changed since the last call.
+      #
       # @return [Array<Symbol>] feature list
       #
       def collect_features
         init_lazy
         log.info("Collecting storage features")
-        features = Set.new
+
+        disks = storage_containers.select { |c| c.type == ::Storage::DISK }
+        disks.each do |disk|
+          # the transport of a disk never changes
+          update_device(@disk_features, disk.name, nil) { collect_container_features(disk) }
+        end
+        remove_stale_devices(@disk_features, disks.map(&:name))
+
+        volumes = volume_keys(storage_volumes)
+        volumes.each do |key, vol|
+          update_device(@volume_features, key, volume_signature(vol)) do
+            collect_volume_features(vol)
+          end
+        end
+        remove_stale_devices(@volume_features, volumes.map(&:first))
+
+        features = Set.new(feature_counts.keys)
+        feature_check(features, "System", "") { @storage.getEfiBoot ? :FT_EFIBOOT : nil }
+        log.info("Storage features used: #{features.to_a} counts: #{feature_counts}")
+
+        features.to_a
+      end
+
+      # Number of disks and volumes using each feature as of the last
+      # collect_features. Features no device uses anymore are left out.
+      #
+      # @return [Hash{Symbol => Integer}] reference count per feature
+      #
+      def feature_counts
+        @feature_counts.select { |_feature, count| count > 0 }
+      end
+
+      # @return [Array<ContainerInfo>] all containers (from libstorage)
+      def storage_containers
         containers = ::Storage::DequeContainerInfo.new
         @storage.getContainers(containers)
-        containers.each { |c| features.merge(collect_container_features(c)) }
+        containers.to_a
+      end
 
+      # @return [Array<VolumeInfo>] all volumes (from libstorage)
+      def storage_volumes
         volumes = ::Storage::DequeVolumeInfo.new
         @storage.getVolumes(volumes)
-        volumes.each { |v| features.merge(collect_volume_features(v)) }
+        volumes.to_a
+      end
 
-        feature_check(features, "System", "") { @storage.getEfiBoot ? :FT_EFIBOOT : nil }
-        log.info("Storage features used: #{features.to_a}")
+      # Pair every volume with a unique key. The name is not unique: a btrfs
+      # volume has the name of its partition, e.g. /dev/sda2 is listed as
+      # partition and as volume of /dev/btrfs. VolumeInfo does not tell the
+      # container, but libstorage lists the volumes container by container,
+      # so the key is the name and the number of volumes with that name
+      # listed before.
+      #
+      # @param [Array<VolumeInfo>] volumes
+      # @return [Array<Array>] volumes as [[name, index], volume]
+      #
+      def volume_keys(volumes)
+        seen = Hash.new(0)
+        volumes.map do |vol|
+          key = [vol.name, seen[vol.name]]
+          seen[vol.name] += 1
+          [key, vol]
+        end
+      end
 
-        features.to_a
+      # Everything of a volume collect_volume_features looks at.
+      #
+      # @param [VolumeInfo] vol
+      # @return [Array] signature
+      #
+      def volume_signature(vol)
+        [
+          vol.usedBy.map(&:type),
+          vol.encryption,
+          vol.mount,
+          vol.fs,
+          vol.fstab_options,
+          vol.userdata.to_h
+        ]
+      end
+
+      # Recompute the features of a device with the supplied code block
+      # unless its signature is unchanged, and update the reference counts.
+      #
+      # @param [Hash] cache of the device type
+      # @param [Object] key of the device, unique within the cache
+      # @param [Object] signature of the device
+      # @param [Block] code block returning the feature set of the device
+      #
+      def update_device(cache, key, signature, &block)
+        old = cache[key]
+        return if old && old[0] == signature
+
+        features = block.call
+        old[1].each { |feature| @feature_counts[feature] -= 1 } if old
+        features.each { |feature| @feature_counts[feature] += 1 }
+        cache[key] = [signature, features]
+      end
+
+      # Forget the devices in cache that are not present anymore and drop
+      # the reference counts of their features.
+      #
+      # @param [Hash] cache of the device type
+      # @param [Array] keys of the devices currently present
+      #
+      def remove_stale_devices(cache, keys)
+        present = Set.new(keys)
+        cache.keys.each do |key|
+          next if present.include?(key)
+          log.info("#{key} is gone, dropping #{cache[key][1].to_a}")
+          cache.delete(key)[1].each { |feature| @feature_counts[feature] -= 1 }
+        end
       end
 
       # Collect storage features for one container and return a feature set.
@@ -84,6 +84,11 @@ module Yast
 
       @sint = nil
 
+      # capabilities of the filesystems indexed by libstorage filesystem id,
+      # built once by BuildFsCapabilities
+      @fs_capabilities = nil
+      @fs_ids = {}
+
 
       @FstabOptionStrings = [
         "defaults",
@@ -1444,6 +1449,7 @@ module Yast
           "InitSlib used default_subvol:\"%1\"",
           @default_subvol
         )
+        BuildFsCapabilities()
       end
 
       nil
@@ -1455,10 +1461,57 @@ module Yast
         @sint = StorageInit.CreateInterface(false)
         Builtins.y2error("StorageInit::CreateInterface failed") if @sint == nil
       end
+      BuildFsCapabilities() if @fs_capabilities == nil && @sint != nil
 
       nil
     end
 
+
+    # Queries libstorage once for the capabilities of every known filesystem.
+    # The result is a read-only list indexed by libstorage filesystem id,
+    # entries are nil for filesystems libstorage knows nothing about.
+    def BuildFsCapabilities
+      table = []
+      @fs_ids = {}
+      Builtins.foreach(Ops.get_map(@conv_fs, "m", {})) do |id, sym|
+        @fs_ids[sym] = id
+        caps = ::Storage::FsCapabilities.new()
+        next if !@sint.getFsCapabilities(id, caps)
+        table[id] = {
+          "extend"        => caps.isExtendable,
+          "mount_extend"  => caps.isExtendableWhileMounted,
+          "shrink"        => caps.isReduceable,
+          "mount_shrink"  => caps.isReduceableWhileMounted,
+          "uuid"          => caps.supportsUuid,
+          "label"         => caps.supportsLabel,
+          "label_mounted" => caps.labelWhileMounted,
+          "label_length"  => caps.labelLength,
+          "min_size_k"    => caps.minimalFsSizeK
+        }.freeze
+      end
+      @fs_capabilities = table.freeze
+      Builtins.y2milestone("BuildFsCapabilities %1", @fs_capabilities)
+
+      nil
+    end
+
+
+    # Returns the list built by BuildFsCapabilities.
+    def FsCapabilities
+      assertInit
+      @fs_capabilities || []
+    end
+
+
+    # Returns the capabilities of fsys or an empty map if unknown.
+    def FsCapability(fsys)
+      # fills @fs_ids on first use
+      capabilities = FsCapabilities()
+      id = Ops.get(@fs_ids, fsys, Ops.get_integer(@conv_fs, "def_int", -1))
+      return {} if id < 0
+      Ops.get(capabilities, id) || {}
+    end
+
     def IsSupported(used_fs)
       Ops.get(@support, used_fs, false)
     end
@@ -1549,85 +1602,39 @@ module Yast
 
 
     def MinFsSizeK(fsys)
-      ret = 0
-      assertInit
-      id = fromSymbol(@conv_fs, fsys)
-      caps = ::Storage::FsCapabilities.new()
-      if @sint.getFsCapabilities(id, caps)
-        ret = caps.minimalFsSizeK
-      end
-      Builtins.y2milestone("MinFsSizeK fsys:%1 ret:%2", fsys, ret)
-      ret
+      Ops.get_integer(FsCapability(fsys), "min_size_k", 0)
     end
 
 
     def MountUuid(fsys)
-      ret = false
-      assertInit
-      id = fromSymbol(@conv_fs, fsys)
-      caps = ::Storage::FsCapabilities.new()
-      if @sint.getFsCapabilities(id, caps)
-        ret = caps.supportsUuid
-      end
-      Builtins.y2milestone("MountUuid fsys:%1 ret:%2", fsys, ret)
-      ret
+      Ops.get_boolean(FsCapability(fsys), "uuid", false)
     end
 
 
     def MountLabel(fsys)
-      ret = false
-      assertInit
-      id = fromSymbol(@conv_fs, fsys)
-      caps = ::Storage::FsCapabilities.new()
-      if @sint.getFsCapabilities(id, caps)
-        ret = caps.supportsLabel
-      end
-      Builtins.y2milestone("MountLabel fsys:%1 ret:%2", fsys, ret)
-      ret
+      Ops.get_boolean(FsCapability(fsys), "label", false)
     end
 
 
     def ChangeLabelMounted(fsys)
-      ret = false
-      assertInit
-      id = fromSymbol(@conv_fs, fsys)
-      caps = ::Storage::FsCapabilities.new()
-      if @sint.getFsCapabilities(id, caps)
-        ret = caps.labelWhileMounted
-      end
-      Builtins.y2milestone("ChangeLabelMounted fsys:%1 ret:%2", fsys, ret)
-      ret
+      Ops.get_boolean(FsCapability(fsys), "label_mounted", false)
     end
 
 
     def LabelLength(fsys)
-      ret = 0
-      assertInit
-      id = fromSymbol(@conv_fs, fsys)
-      caps = ::Storage::FsCapabilities.new()
-      if @sint.getFsCapabilities(id, caps)
-        ret = caps.labelLength
-      end
-      Builtins.y2milestone("LabelLength fsys:%1 ret:%2", fsys, ret)
-      ret
+      Ops.get_integer(FsCapability(fsys), "label_length", 0)
     end
 
 
     def IsResizable(fsys)
-      ret = {}
-      assertInit
-      id = fromSymbol(@conv_fs, fsys)
-      caps = ::Storage::FsCapabilities.new()
-      if @sint.getFsCapabilities(id, caps)
-        ret = {
-          "extend"       => caps.isExtendable,
-          "shrink"       => caps.isReduceable,
-          "mount_extend" => caps.isExtendableWhileMounted,
-          "mount_shrink" => caps.isReduceableWhileMounted
-        }
-      end
-      Builtins.y2milestone("IsResizable fsys:%1 ret:%2", fsys, ret)
-      deep_copy(ret)
+      caps = FsCapability(fsys)
+      return {} if caps.empty?
+      {
+        "extend"       => caps["extend"],
+        "shrink"       => caps["shrink"],
+        "mount_extend" => caps["mount_extend"],
+        "mount_shrink" => caps["mount_shrink"]
+      }
     end
 
 
@@ -2064,6 +2071,7 @@ module Yast
     publish :function => :GetOptions, :type => "list (symbol)"
     publish :function => :GetMountString, :type => "string (symbol, string)"
     publish :function => :GetNeededModules, :type => "list <string> (symbol)"
+    publish :function => :FsCapabilities, :type => "list <map <string, any>> ()"
     publish :function => :MinFsSizeK, :type => "integer (symbol)"
     publish :function => :MountUuid, :type => "boolean (symbol)"
     publish :function => :MountLabel, :type => "boolean (symbol)"
@@ -127,6 +127,50 @@ module Yast
       @sint = nil
 
       @prep_boot_first = true
+
+      # properties of partition ids, indexed by partition id
+      @fsid_flags = BuildFsidFlags()
+    end
+
+
+    FSID_DOS = 1
+    FSID_NTFS = 2
+    FSID_EXTENDED = 4
+    FSID_SWAP = 8
+    FSID_PREP = 16
+    FSID_LINUX = 32
+    FSID_RESIZABLE = 64
+
+    # Builds the table used by the IsXxxPartition predicates, a read-only
+    # list with a bitmask of FSID_* flags per partition id.
+    def BuildFsidFlags
+      flags = Array.new(
+        [@fsid_mac_hidden, @fsid_gpt_boot, @fsid_gpt_prep, @fsid_bios_grub].max + 1,
+        0
+      )
+      add = lambda do |fsids, flag|
+        Builtins.foreach(fsids) { |fsid| flags[fsid] |= flag }
+      end
+      add.call(@fsid_dostypes + @fsid_wintypes, FSID_DOS)
+      add.call(@fsid_ntfstypes, FSID_NTFS)
+      add.call([@fsid_extended, @fsid_extended_win], FSID_EXTENDED)
+      add.call([@fsid_swap], FSID_SWAP)
+      add.call([@fsid_prep_chrp_boot, @fsid_gpt_prep], FSID_PREP)
+      add.call(
+        [@fsid_native, @fsid_swap, @fsid_lvm, @fsid_raid, @fsid_gpt_boot],
+        FSID_LINUX
+      )
+      add.call(
+        [@fsid_swap, @fsid_native, @fsid_gpt_boot, @fsid_extended, @fsid_extended_win] +
+          @fsid_dostypes + @fsid_wintypes + @fsid_ntfstypes,
+        FSID_RESIZABLE
+      )
+      flags.freeze
+    end
+
+    def FsidFlag(fsid, flag)
+      fsid.is_a?(::Integer) && fsid >= 0 &&
+        (Ops.get(@fsid_flags, fsid, 0) & flag) != 0
     end
 
     def InitSlib(value)
@@ -349,24 +393,23 @@ module Yast
 
 
     def IsDosPartition(fsid)
-      Builtins.contains(@fsid_dostypes, fsid) ||
-        Builtins.contains(@fsid_wintypes, fsid)
+      FsidFlag(fsid, FSID_DOS)
     end
 
     def IsDosWinNtPartition(fsid)
-      IsDosPartition(fsid) || Builtins.contains(@fsid_ntfstypes, fsid)
+      FsidFlag(fsid, FSID_DOS | FSID_NTFS)
     end
 
     def IsExtendedPartition(fsid)
-      fsid == @fsid_extended || fsid == @fsid_extended_win
+      FsidFlag(fsid, FSID_EXTENDED)
     end
 
     def IsSwapPartition(fsid)
-      !IsDosWinNtPartition(fsid) && fsid == @fsid_swap
+      FsidFlag(fsid, FSID_SWAP)
     end
 
     def IsPrepPartition(fsid)
-      return fsid == @fsid_prep_chrp_boot || fsid == @fsid_gpt_prep
+      FsidFlag(fsid, FSID_PREP)
     end
 
 
@@ -457,17 +500,12 @@ module Yast
 
 
     def IsResizable(fsid)
-      ret = [@fsid_swap, @fsid_native, @fsid_gpt_boot].include?(fsid) ||
-        IsDosWinNtPartition(fsid) || IsExtendedPartition(fsid)
-      log.info("IsResizable fsid:#{fsid} ret:#{ret}")
-      return ret
+      FsidFlag(fsid, FSID_RESIZABLE)
     end
 
 
     def IsLinuxPartition(fsid)
-      fsid == @fsid_native || fsid == @fsid_swap || fsid == @fsid_lvm ||
-        fsid == @fsid_raid ||
-        fsid == @fsid_gpt_boot
+      FsidFlag(fsid, FSID_LINUX)
     end
 
     def GetLoopOn(device)
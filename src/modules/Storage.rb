@@ -34,6 +34,14 @@ module Yast
     include Yast::StorageHelpers::TargetMapFormatter
 
 
+    # retention defaults, see WriteTargetDump
+    MAX_TARGET_DUMPS = 20
+    MAX_TARGET_DUMP_SIZE = 32 * 1024 * 1024
+
+    # rough size of the free space information libstorage caches per device
+    FREE_INFO_BYTES = 512
+
+
     def main
       Yast.import "Pkg"
       Yast.import "UI"
@@ -56,6 +64,7 @@ module Yast
       Yast.import "StorageInit"
       Yast.import "StorageDevices"
       Yast.import "StorageClients"
+      Yast.import "StorageCallbacks"
       Yast.import "StorageSnapper"
       Yast.import "Stage"
       Yast.import "String"
@@ -293,6 +302,23 @@ module Yast
 
       @count = 0
 
+      # target map dumps written to the tmpdir, oldest first, each as
+      # [path, size], and backup states as who => estimated bytes, see
+      # CreateTargetBackup and WriteTargetDump
+      @target_dumps = []
+      @backup_states = {}
+
+      # devices for which libstorage caches free space information
+      @free_info_devices = {}
+
+      # nesting level of target map batches and whether an update of the
+      # target map was deferred, see BeginTargetMapBatch
+      @batch_level = 0
+      @batch_update_pending = false
+
+      # see used_storage_features
+      @used_features = nil
+
       @save_chtxt = ""
 
 
@@ -366,8 +392,16 @@ module Yast
       return if @sint == nil
 
       log.info("FinishLibstorage")
+      log.info("FinishLibstorage memory:#{StorageCallbacks.MemoryUsage()}")
+      StorageCallbacks.StopRecording()
       ::Storage::destroyStorageInterface(@sint)
       @sint = nil
+      @free_info_devices = {}
+      StorageCallbacks.AccountMemory("free_info", 0)
+      @backup_states.each_key do |who|
+        StorageCallbacks.AccountMemory("backup:" + who, 0)
+      end
+      @backup_states = {}
 
       nil
     end
@@ -940,6 +974,12 @@ module Yast
         end
       end
 
+      if ret && !@free_info_devices.include?(device)
+        @free_info_devices[device] = true
+        StorageCallbacks.AccountMemory("free_info",
+          @free_info_devices.size * FREE_INFO_BYTES)
+      end
+
       Builtins.y2milestone("GetFreeInfo device: %1 ret: %2", device, ret)
       ret
     end
@@ -1114,6 +1154,72 @@ module Yast
     end
 
 
+    # Limit of an environment variable or the default if unset or invalid.
+    def RetentionLimit(env, default)
+      value = ENV[env].to_i
+      value > 0 ? value : default
+    end
+
+
+    # Returns the paths of the dumps to remove so that at most max_count
+    # dumps with a total size of at most max_size remain. The newest dump is
+    # always kept.
+    #
+    # @param [Array<Array>] dumps dumps as [path, size], oldest first
+    # @param [Fixnum] max_count
+    # @param [Fixnum] max_size
+    # @return [Array<String>] paths, oldest first
+    def TargetDumpsToPrune(dumps, max_count, max_size)
+      total = dumps.inject(0) { |sum, (_path, size)| sum + size }
+      ret = []
+      dumps[0...-1].each do |path, size|
+        break if dumps.size - ret.size <= max_count && total <= max_size
+        ret << path
+        total -= size
+      end
+      ret
+    end
+
+
+    # Writes the target map to a dump in the tmpdir and removes the oldest
+    # dumps if there are more than YAST2_STORAGE_MAX_DUMPS or they are larger
+    # than YAST2_STORAGE_MAX_DUMP_SIZE bytes. Returns the size of the dump.
+    def WriteTargetDump(name)
+      file = SaveDumpPath(name)
+      SCR.Write(path(".target.ycp"), file, GetTargetMap())
+      size = [SCR.Read(path(".target.size"), file).to_i, 0].max
+
+      @target_dumps.reject! { |dump_path, _size| dump_path == file }
+      @target_dumps << [file, size]
+
+      prune = TargetDumpsToPrune(@target_dumps,
+        RetentionLimit("YAST2_STORAGE_MAX_DUMPS", MAX_TARGET_DUMPS),
+        RetentionLimit("YAST2_STORAGE_MAX_DUMP_SIZE", MAX_TARGET_DUMP_SIZE))
+      if !prune.empty?
+        Builtins.y2milestone("WriteTargetDump removing %1", prune)
+        prune.each { |dump_path| SCR.Execute(path(".target.remove"), dump_path) }
+        @target_dumps.reject! { |dump_path, _size| prune.include?(dump_path) }
+      end
+
+      AccountTargetMap()
+      size
+    end
+
+
+    # Accounts the serialized size of the cached target map as estimate of
+    # the memory it holds. Sampled whenever a dump is written.
+    def AccountTargetMap
+      bytes = begin
+        Marshal.dump(Ops.get_map(@StorageMap, @targets_key, {})).bytesize
+      rescue TypeError
+        0
+      end
+      StorageCallbacks.AccountMemory("target_map", bytes)
+
+      nil
+    end
+
+
     def convertFsOptionMapToString(fsopt, cmd)
       fsopt = deep_copy(fsopt)
       ret = ""
@@ -1949,33 +2055,18 @@ module Yast
           "fstopt",
           "userdata"
         ]
+        edits = []
         Builtins.foreach(simple) do |p|
-          mp = GetPartition(tg, p["device"])
-          Builtins.y2milestone("HandleBtrfsSimpleVolumes before %1", mp)
+          device = Ops.get_string(p, "device", "")
           Builtins.foreach(keys) do |k|
             if Ops.get(p, k) != nil
-              Builtins.y2milestone("HandleBtrfsSimpleVolumes set key %1", k)
-              tg = SetPartitionData(
-                tg,
-                Ops.get_string(p, "device", ""),
-                k,
-                Ops.get(p, k)
-              )
+              edits << [device, k, Ops.get(p, k)]
             else
-              if Builtins.haskey(mp, k)
-                Builtins.y2milestone(
-                  "HandleBtrfsSimpleVolumes remove key %1",
-                  k
-                )
-                tg = DelPartitionData(tg, Ops.get_string(p, "device", ""), k)
-              end
+              edits << [device, k]
             end
           end
-          Builtins.y2milestone(
-            "HandleBtrfsSimpleVolumes after  %1",
-            GetPartition(tg, Ops.get_string(p, "device", ""))
-          )
         end
+        tg = ChangePartitionsData(tg, edits)
       end
       deep_copy(tg)
     end
@@ -1985,6 +2076,10 @@ module Yast
     #
     # @see #GetTargetMap()
     def UpdateTargetMap
+      if @batch_level > 0
+        @batch_update_pending = true
+        return nil
+      end
       @conts = getContainers
       rem_keys = []
       tg = Ops.get_map(@StorageMap, @targets_key, {})
@@ -2022,20 +2117,13 @@ module Yast
           end
         )
         Builtins.y2milestone("simple %1", simple)
+        edits = []
         Builtins.foreach(simple) do |p|
-          tg = SetPartitionData(
-            tg,
-            Ops.get_string(p, "device", ""),
-            "subvol",
-            Ops.get_list(p, "subvol", [])
-          )
-          tg = SetPartitionData(
-            tg,
-            Ops.get_string(p, "device", ""),
-            "userdata",
-            Ops.get_map(p, "userdata", {})
-          )
+          device = Ops.get_string(p, "device", "")
+          edits << [device, "subvol", Ops.get_list(p, "subvol", [])]
+          edits << [device, "userdata", Ops.get_map(p, "userdata", {})]
         end
+        tg = ChangePartitionsData(tg, edits)
       end
       Builtins.y2milestone("UpdateTargetMap rem_keys: %1", rem_keys)
       Builtins.foreach(rem_keys) { |dev| tg = Builtins.remove(tg, dev) }
@@ -2059,6 +2147,10 @@ module Yast
 
 
     def UpdateTargetMapDisk(dev)
+      if @batch_level > 0
+        @batch_update_pending = true
+        return nil
+      end
       Builtins.y2milestone("UpdateTargetMapDisk")
       @conts = getContainers
       c = {}
@@ -2095,6 +2187,10 @@ module Yast
 
 
     def UpdateTargetMapDev(dev)
+      if @batch_level > 0
+        @batch_update_pending = true
+        return nil
+      end
       Builtins.y2milestone("UpdateTargetMapDev %1", dev)
       tg = Ops.get_map(@StorageMap, @targets_key, {})
       #SCR::Write(.target.ycp, "/tmp/upd_dev_bef_"+sformat("%1",count), tg );
@@ -2232,17 +2328,24 @@ module Yast
     end
 
 
+    # Creates a backup state of libstorage. A backup state is a copy of all
+    # containers, so its memory is estimated by the size of the target map
+    # dump. Backup states are only disposed by their owners since only they
+    # know when a state is not needed anymore.
     def CreateTargetBackup(who)
       t = Ops.add(
         Ops.add(Ops.add("targetMap_s_", who), "_"),
         Builtins.sformat("%1", @count)
       )
       @count = Ops.add(@count, 1)
-      SCR.Write(path(".target.ycp"), SaveDumpPath(t), GetTargetMap())
+      size = WriteTargetDump(t)
       Builtins.y2milestone("CreateTargetBackup who: %1", who)
       ret = @sint.createBackupState(who)
       if ret<0
         Builtins.y2error("CreateTargetBackup sint ret: %1", ret)
+      else
+        @backup_states[who] = size
+        StorageCallbacks.AccountMemory("backup:" + who, size)
       end
 
       nil
@@ -2255,6 +2358,8 @@ module Yast
       if ret<0
         Builtins.y2error("DisposeTargetBackup sint ret: %1", ret)
       end
+      @backup_states.delete(who)
+      StorageCallbacks.AccountMemory("backup:" + who, 0)
 
       nil
     end
@@ -2278,7 +2383,7 @@ module Yast
       end
       UpdateTargetMap()
       t = Ops.add("targetMap_r_", who)
-      SCR.Write(path(".target.ycp"), SaveDumpPath(t), GetTargetMap())
+      WriteTargetDump(t)
 
       # Cleanup memory about deleted shadowed subvolumes
       ShadowedVolHelper.instance.reset
@@ -3870,44 +3975,39 @@ module Yast
     # @param [Hash{String => map}] target Disk map
     # @return [Hash{String => map}] modified target
     def AddSwapMp(target)
-      target = deep_copy(target)
       swaps = SwappingPartitions()
       Builtins.y2milestone("AddSwapMp swaps %1", swaps)
+      edits = []
       Builtins.foreach(target) do |diskdev, disk|
-        Ops.set(
-          disk,
-          "partitions",
-          Builtins.maplist(Ops.get_list(disk, "partitions", [])) do |part|
-            if Stage.initial &&
-                !Partitions.IsDosWinNtPartition(
-                  Ops.get_integer(part, "fsid", 0)
-                ) &&
-                Ops.get_symbol(part, "detected_fs", :unknown) == :swap &&
-                !Ops.get_boolean(part, "old_swap", false) &&
-                Builtins.search(diskdev, "/dev/evms") != 0 ||
-                Builtins.contains(swaps, Ops.get_string(part, "device", ""))
-              Builtins.y2milestone("AddSwapMp %1", part)
-              ok = true
-              if !Builtins.contains(swaps, Ops.get_string(part, "device", ""))
-                dev = Ops.get_string(part, "device", "")
-                if !Builtins.isempty(Ops.get_string(part, "crypt_device", ""))
-                  dev = Ops.get_string(part, "crypt_device", "")
-                end
-                ok = CheckSwapable(dev)
-                Builtins.y2milestone("AddSwapMp initial ok: %1", ok)
-              end
-              if ok
-                Ops.set(part, "mount", "swap")
-                ChangeVolumeProperties(part)
-                Builtins.y2milestone("AddSwapMp %1", part)
+        Builtins.foreach(Ops.get_list(disk, "partitions", [])) do |part|
+          if Stage.initial &&
+              !Partitions.IsDosWinNtPartition(
+                Ops.get_integer(part, "fsid", 0)
+              ) &&
+              Ops.get_symbol(part, "detected_fs", :unknown) == :swap &&
+              !Ops.get_boolean(part, "old_swap", false) &&
+              Builtins.search(diskdev, "/dev/evms") != 0 ||
+              Builtins.contains(swaps, Ops.get_string(part, "device", ""))
+            Builtins.y2milestone("AddSwapMp %1", part)
+            ok = true
+            if !Builtins.contains(swaps, Ops.get_string(part, "device", ""))
+              dev = Ops.get_string(part, "device", "")
+              if !Builtins.isempty(Ops.get_string(part, "crypt_device", ""))
+                dev = Ops.get_string(part, "crypt_device", "")
               end
+              ok = CheckSwapable(dev)
+              Builtins.y2milestone("AddSwapMp initial ok: %1", ok)
+            end
+            if ok
+              part = Builtins.add(part, "mount", "swap")
+              ChangeVolumeProperties(part)
+              Builtins.y2milestone("AddSwapMp %1", part)
+              edits << [Ops.get_string(part, "device", ""), "mount", "swap"]
             end
-            deep_copy(part)
           end
-        )
-        Ops.set(target, diskdev, disk)
+        end
       end
-      deep_copy(target)
+      ChangePartitionsData(target, edits)
     end
 
 
@@ -4590,245 +4690,276 @@ module Yast
 
 
     # Sets the target map.
-    # This function should not be used since it is very fragile. Error
-    # handling is basically non-existing. Instead use individual functions to
-    # modify devices.
+    # This function should not be used since it is very fragile. Instead use
+    # individual functions to modify devices or ApplyTargetMap which at least
+    # reports the operations that failed.
     def SetTargetMap(target)
-      target = deep_copy(target)
-      save_crypt = {}
-      Builtins.y2milestone("SetTargetMap")
+      ApplyTargetMap(target)
+
+      nil
+    end
+
+
+    # Applies the differences between target and the current target map.
+    #
+    # All needed libstorage operations are first collected and ordered by
+    # PlanTargetMapChanges and then executed inside one target map batch, so
+    # the target map is only reread once at the end instead of after every
+    # single operation.
+    #
+    # @param [Hash{String => map}] target target map
+    # @return [Array<Hash>] failed operations, each with the keys "operation",
+    #   "container" and "device", empty if everything succeeded
+    def ApplyTargetMap(target)
+      Builtins.y2milestone("ApplyTargetMap")
       SetRecursiveRemoval(true) if !GetRecursiveRemoval()
-      #SCR::Write(.target.ycp, Storage::SaveDumpPath("targetMap_set_"+sformat("%1",count)), target );
-      #count = count+1;
       CreateTargetBackup("tmp_set")
-      tg = GetTargetMap()
-      keys = Builtins.maplist(target) { |k, e| k }
-      Builtins.foreach(keys) do |k|
-        if Ops.get_boolean(target, [k, "delete"], false) &&
-            Builtins.haskey(tg, k)
-          if Ops.get_symbol(target, [k, "type"], :CT_UNKNOWN) == :CT_LVM
-            DeleteLvmVg(Ops.get_string(target, [k, "name"], ""))
-            Ops.set(target, [k, "delete"], false)
-          elsif Ops.get_symbol(target, [k, "type"], :CT_UNKNOWN) == :CT_DMRAID
-            DeleteDmraid(k)
-            Ops.set(target, [k, "delete"], false)
+      failed = []
+      begin
+        ops = PlanTargetMapChanges(target, GetTargetMap())
+        Builtins.y2milestone("ApplyTargetMap ops: %1", ops.size)
+        save_crypt = {}
+
+        BeginTargetMapBatch()
+        begin
+          ops.each do |op|
+            ok = ApplyTargetMapOperation(op, save_crypt)
+            if !ok
+              failed << {
+                "operation" => op["operation"],
+                "container" => op["container"],
+                "device"    => op["device"]
+              }
+            end
           end
+        ensure
+          EndTargetMapBatch()
         end
+
+        Builtins.y2error("ApplyTargetMap failed: %1", failed) if !failed.empty?
+        changed = !EqualBackupStates("tmp_set", "", true)
+        Builtins.y2milestone("ApplyTargetMap changed: %1", changed)
+        UpdateChangeTime() if changed
+      ensure
+        # the backup state must not outlive the batch, not even on errors
+        DisposeTargetBackup("tmp_set")
       end
-      keys = Builtins.maplist(target) { |k, e| k }
-      Builtins.y2milestone("SetTargetMap keys %1", keys)
-      t1 = Builtins.filter(keys) do |k|
-        !Ops.get_boolean(target, [k, "delete"], false) &&
-          !Ops.get_boolean(target, [k, "create"], false)
-      end
-      Builtins.foreach(t1) do |k|
-        dps = Builtins.filter(Ops.get_list(target, [k, "partitions"], [])) do |p|
-          !Ops.get_boolean(p, "create", false) &&
-            !Ops.get_boolean(p, "delete", false)
-        end
-        Builtins.foreach(dps) do |p|
-          if Ops.get_symbol(p, "type", :primary) != :extended ||
-              Ops.get_boolean(p, "resize", false)
-            ChangeVolumeProperties(p)
-          end
-        end if Ops.greater_than(
-          Builtins.size(dps),
-          0
-        )
-      end
-      keys = Builtins.maplist(tg) { |k, e| k }
-      keys = Builtins.sort(keys) do |a, b|
-        Ops.greater_than(
-          Ops.get(@type_order, Ops.get_symbol(tg, [a, "type"], :CT_UNKNOWN), 9),
-          Ops.get(@type_order, Ops.get_symbol(tg, [b, "type"], :CT_UNKNOWN), 9)
-        )
-      end
-      Builtins.y2milestone("SetTargetMap keys %1", keys)
-      Builtins.foreach(keys) do |k|
-        dps = Builtins.filter(Ops.get_list(tg, [k, "partitions"], [])) do |p|
-          Ops.get_boolean(p, "create", false)
-        end
-        if Ops.greater_than(Builtins.size(dps), 1) &&
-            Builtins.haskey(Ops.get(dps, 0, {}), "nr")
-          dps = Builtins.sort(dps) do |a, b|
-            Ops.greater_than(
-              Ops.get_integer(a, "nr", 0),
-              Ops.get_integer(b, "nr", 0)
-            )
+      Builtins.y2milestone("ApplyTargetMap ChangeTime %1", GetTargetChangeTime())
+
+      failed
+    end
+
+
+    # Computes the ordered list of libstorage operations needed to turn the
+    # target map tg into target. Only looks at the maps, nothing is changed.
+    #
+    # The order is the one needed by libstorage: deletion of removed volume
+    # groups and dmraids, property changes of existing volumes, undoing
+    # creations of tg that are no longer wanted, deletions, and finally
+    # creations with containers sorted by their type.
+    #
+    # @param [Hash{String => map}] target target map
+    # @param [Hash{String => map}] tg current target map
+    # @return [Array<Hash>] operations, each with the keys "operation",
+    #   "container", "device" and additional arguments
+    def PlanTargetMapChanges(target, tg)
+      target = deep_copy(target)
+      ops = []
+
+      target.each do |k, c|
+        next if !c.fetch("delete", false) || !tg.has_key?(k)
+        case c.fetch("type", :CT_UNKNOWN)
+        when :CT_LVM
+          ops << { "operation" => "DeleteLvmVg", "container" => k,
+                   "device" => k, "name" => c.fetch("name", "") }
+          c["delete"] = false
+        when :CT_DMRAID
+          ops << { "operation" => "DeleteDmraid", "container" => k, "device" => k }
+          c["delete"] = false
+        end
+      end
+
+      target.each do |k, c|
+        next if c.fetch("delete", false) || c.fetch("create", false)
+        c.fetch("partitions", []).each do |p|
+          next if p.fetch("create", false) || p.fetch("delete", false)
+          if p.fetch("type", :primary) != :extended || p.fetch("resize", false)
+            ops << { "operation" => "ChangeVolumeProperties", "container" => k,
+                     "device" => p.fetch("device", ""), "volume" => p }
           end
-          Builtins.y2milestone("SetTargetMap dps: %1", dps)
         end
-        Builtins.foreach(dps) do |p|
-          tdev = Ops.get_string(p, "device", "")
-          if Ops.get_symbol(p, "enc_type", :none) != :none
-            Ops.set(save_crypt, tdev, GetCryptPwd(tdev))
-          end
-          DeleteDevice(tdev)
+      end
+
+      tg_keys = tg.keys.sort_by { |k| -@type_order.fetch(tg[k].fetch("type", :CT_UNKNOWN), 9) }
+      Builtins.y2milestone("PlanTargetMapChanges keys %1", tg_keys)
+      tg_keys.each do |k|
+        c = tg[k]
+        sorted_by_nr(c.fetch("partitions", []).select { |p| p.fetch("create", false) }).each do |p|
+          ops << { "operation" => "DeleteDevice", "container" => k,
+                   "device" => p.fetch("device", ""),
+                   "save_crypt" => p.fetch("enc_type", :none) != :none }
         end
-        if Ops.get_boolean(tg, [k, "create"], false)
-          if Ops.get_symbol(tg, [k, "type"], :CT_UNKNOWN) == :CT_LVM
-            DeleteLvmVg(Ops.get_string(tg, [k, "name"], ""))
+        if c.fetch("create", false)
+          if c.fetch("type", :CT_UNKNOWN) == :CT_LVM
+            ops << { "operation" => "DeleteLvmVg", "container" => k,
+                     "device" => k, "name" => c.fetch("name", "") }
           end
-        elsif !Ops.get_boolean(tg, [k, "delete"], false)
-          if Ops.get_symbol(tg, [k, "type"], :CT_UNKNOWN) == :CT_LVM &&
-              Ops.greater_than(
-                Builtins.size(Ops.get_list(target, [k, "devices_add"], [])),
-                0
-              )
-            ls = Ops.get_list(target, [k, "devices_add"], [])
-            Builtins.foreach(ls) do |d|
-              ReduceLvmVg(Ops.get_string(target, [k, "name"], ""), d)
+        elsif !c.fetch("delete", false)
+          if c.fetch("type", :CT_UNKNOWN) == :CT_LVM
+            target.fetch(k, {}).fetch("devices_add", []).each do |d|
+              ops << { "operation" => "ReduceLvmVg", "container" => k, "device" => d,
+                       "name" => target[k].fetch("name", "") }
             end
           end
         end
       end
-      keys = Builtins.maplist(target) { |k, e| k }
-      keys = Builtins.sort(keys) do |a, b|
-        Ops.greater_than(
-          Ops.get(
-            @type_order,
-            Ops.get_symbol(target, [a, "type"], :CT_UNKNOWN),
-            9
-          ),
-          Ops.get(
-            @type_order,
-            Ops.get_symbol(target, [b, "type"], :CT_UNKNOWN),
-            9
-          )
-        )
-      end
-      Builtins.y2milestone("SetTargetMap keys %1", keys)
-      Builtins.foreach(keys) do |k|
-        dps = Builtins.filter(Ops.get_list(target, [k, "partitions"], [])) do |p|
-          Ops.get_boolean(p, "delete", false)
-        end
-        if Ops.greater_than(Builtins.size(dps), 1) &&
-            Builtins.haskey(Ops.get(dps, 0, {}), "nr")
-          dps = Builtins.sort(dps) do |a, b|
-            Ops.greater_than(
-              Ops.get_integer(a, "nr", 0),
-              Ops.get_integer(b, "nr", 0)
-            )
-          end
+
+      keys = target.keys.sort_by { |k| -@type_order.fetch(target[k].fetch("type", :CT_UNKNOWN), 9) }
+      Builtins.y2milestone("PlanTargetMapChanges keys %1", keys)
+      keys.each do |k|
+        c = target[k]
+        sorted_by_nr(c.fetch("partitions", []).select { |p| p.fetch("delete", false) }).each do |p|
+          ops << { "operation" => "DeleteDevice", "container" => k,
+                   "device" => p.fetch("device", ""), "dtxt" => p.fetch("dtxt", "") }
         end
-        Builtins.foreach(dps) do |p|
-          if Ops.greater_than(Builtins.size(Ops.get_string(p, "dtxt", "")), 0)
-            ChangeDescText(
-              Ops.get_string(p, "device", ""),
-              Ops.get_string(p, "dtxt", "")
-            )
-          end
-          DeleteDevice(Ops.get_string(p, "device", ""))
-        end
-        if Ops.get_boolean(target, [k, "delete"], false)
-          if Ops.get_symbol(target, [k, "type"], :CT_UNKNOWN) == :CT_LVM
-            DeleteLvmVg(Ops.get_string(target, [k, "name"], ""))
-          elsif Ops.get_symbol(target, [k, "type"], :CT_UNKNOWN) == :CT_DISK ||
-                Ops.get_symbol(target, [k, "type"], :CT_UNKNOWN) == :CT_DMMULTIPATH
-            DeletePartitionTable(
-              k,
-              Ops.get_string(target, [k, "disklabel"], "")
-            )
-          elsif Ops.get_symbol(target, [k, "type"], :CT_UNKNOWN) == :CT_DMRAID
-            DeleteDmraid(k)
+        if c.fetch("delete", false)
+          case c.fetch("type", :CT_UNKNOWN)
+          when :CT_LVM
+            ops << { "operation" => "DeleteLvmVg", "container" => k,
+                     "device" => k, "name" => c.fetch("name", "") }
+          when :CT_DISK, :CT_DMMULTIPATH
+            ops << { "operation" => "DeletePartitionTable", "container" => k,
+                     "device" => k, "disklabel" => c.fetch("disklabel", "") }
+          when :CT_DMRAID
+            ops << { "operation" => "DeleteDmraid", "container" => k, "device" => k }
           end
         end
-        if Ops.get_boolean(target, [k, "del_ptable"], false) &&
-            IsPartType(Ops.get_symbol(target, [k, "type"], :CT_UNKNOWN))
-          DeletePartitionTable(k, Ops.get_string(target, [k, "disklabel"], ""))
-        end
-      end
-      keys = Builtins.maplist(target) { |k, e| k }
-      keys = Builtins.sort(keys) do |a, b|
-        Ops.less_than(
-          Ops.get(
-            @type_order,
-            Ops.get_symbol(target, [a, "type"], :CT_UNKNOWN),
-            9
-          ),
-          Ops.get(
-            @type_order,
-            Ops.get_symbol(target, [b, "type"], :CT_UNKNOWN),
-            9
-          )
-        )
-      end
-      Builtins.y2milestone("SetTargetMap keys %1", keys)
-      Builtins.foreach(keys) do |k|
-        if Ops.get_boolean(target, [k, "create"], false)
-          if Ops.get_symbol(target, [k, "type"], :CT_UNKNOWN) == :CT_LVM
-            CreateLvmVg(
-              Ops.get_string(target, [k, "name"], ""),
-              Ops.get_integer(target, [k, "pesize"], 0),
-              Ops.get_boolean(target, [k, "lvm2"], true)
-            )
-            ls = Convert.convert(
-              Builtins.union(
-                Ops.get_list(target, [k, "devices"], []),
-                Ops.get_list(target, [k, "devices_add"], [])
-              ),
-              :from => "list",
-              :to   => "list <string>"
-            )
-            Builtins.foreach(ls) do |d|
-              ExtendLvmVg(Ops.get_string(target, [k, "name"], ""), d)
-            end
+        if c.fetch("del_ptable", false) && IsPartType(c.fetch("type", :CT_UNKNOWN))
+          ops << { "operation" => "DeletePartitionTable", "container" => k,
+                   "device" => k, "disklabel" => c.fetch("disklabel", "") }
+        end
+      end
+
+      keys = target.keys.sort_by { |k| @type_order.fetch(target[k].fetch("type", :CT_UNKNOWN), 9) }
+      Builtins.y2milestone("PlanTargetMapChanges keys %1", keys)
+      keys.each do |k|
+        c = target[k]
+        ctype = c.fetch("type", :CT_UNKNOWN)
+        if ctype == :CT_LVM
+          if c.fetch("create", false)
+            ops << { "operation" => "CreateLvmVg", "container" => k, "device" => k,
+                     "name" => c.fetch("name", ""), "pesize" => c.fetch("pesize", 0),
+                     "lvm2" => c.fetch("lvm2", true) }
+            devices = Builtins.union(c.fetch("devices", []), c.fetch("devices_add", []))
+          elsif !c.fetch("delete", false)
+            devices = c.fetch("devices_add", [])
+          else
+            devices = []
           end
-        end
-        if !Ops.get_boolean(target, [k, "delete"], false) &&
-            !Ops.get_boolean(target, [k, "create"], false)
-          if Ops.get_symbol(target, [k, "type"], :CT_UNKNOWN) == :CT_LVM &&
-              Ops.greater_than(
-                Builtins.size(Ops.get_list(target, [k, "devices_add"], [])),
-                0
-              )
-            ls = Ops.get_list(target, [k, "devices_add"], [])
-            Builtins.foreach(ls) do |d|
-              ExtendLvmVg(Ops.get_string(target, [k, "name"], ""), d)
-            end
+          devices.each do |d|
+            ops << { "operation" => "ExtendLvmVg", "container" => k, "device" => d,
+                     "name" => c.fetch("name", "") }
           end
         end
-        dps = Builtins.filter(Ops.get_list(target, [k, "partitions"], [])) do |p|
-          !Ops.get_boolean(p, "delete", false) &&
-            Ops.get_boolean(p, "create", false)
+        dps = c.fetch("partitions", []).select do |p|
+          !p.fetch("delete", false) && p.fetch("create", false)
         end
         if dps.size>1
-	  Builtins.y2milestone("SetTargetMap dps:\n%1", format_target_map(dps))
-	  if dps.fetch(0,{}).has_key?("nr")
-	    dps.sort! { |a, b| a.fetch("nr",0)<=>b.fetch("nr",0) }
-	  elsif dps.fetch(0,{}).fetch("type",:none)==:lvm
-	    dps = dps.partition { |a| a.fetch("pool",false) }
-          end
-	  Builtins.y2milestone("SetTargetMap dps:\n%1", format_target_map(dps))
-        end
-        Builtins.foreach(dps) do |p|
-          p_ref = arg_ref(p)
-          CreateAny(
-            Ops.get_symbol(target, [k, "type"], :CT_UNKNOWN),
-            Ops.get(target, k, {}),
-            p_ref
-          )
-          p = p_ref.value
-          tdev = Ops.get_string(p, "device", "")
-          if Ops.get_symbol(p, "enc_type", :none) != :none &&
-              !Builtins.isempty(Ops.get(save_crypt, tdev, "")) &&
-              Builtins.isempty(GetCryptPwd(tdev))
-            SetCryptPwd(tdev, Ops.get(save_crypt, tdev, ""))
-          end
-          if Ops.get_symbol(p, "type", :primary) != :extended
-            ChangeVolumeProperties(p)
+          if dps.first.has_key?("nr")
+            dps.sort! { |a, b| a.fetch("nr",0)<=>b.fetch("nr",0) }
+          elsif dps.first.fetch("type",:none)==:lvm
+            dps = dps.partition { |a| a.fetch("pool",false) }.flatten
           end
         end
+        dps.each do |p|
+          ops << { "operation" => "CreateAny", "container" => k,
+                   "device" => p.fetch("device", ""), "ctype" => ctype,
+                   "disk" => c, "volume" => p }
+        end
+      end
+
+      ops
+    end
+
+
+    # Executes a single operation computed by PlanTargetMapChanges.
+    #
+    # @param [Hash] op the operation
+    # @param [Hash{String => String}] save_crypt crypt passwords of deleted
+    #   devices, used to restore them on recreated devices
+    # @return [Boolean] true on success
+    def ApplyTargetMapOperation(op, save_crypt)
+      dev = op["device"]
+      case op["operation"]
+      when "DeleteLvmVg"
+        DeleteLvmVg(op["name"])
+      when "DeleteDmraid"
+        DeleteDmraid(dev)
+      when "DeletePartitionTable"
+        DeletePartitionTable(dev, op["disklabel"])
+      when "ReduceLvmVg"
+        ReduceLvmVg(op["name"], dev)
+      when "CreateLvmVg"
+        CreateLvmVg(op["name"], op["pesize"], op["lvm2"])
+      when "ExtendLvmVg"
+        ExtendLvmVg(op["name"], dev)
+      when "ChangeVolumeProperties"
+        ChangeVolumeProperties(op["volume"])
+      when "DeleteDevice"
+        save_crypt[dev] = GetCryptPwd(dev) if op["save_crypt"]
+        ChangeDescText(dev, op["dtxt"]) if !op.fetch("dtxt", "").empty?
+        DeleteDevice(dev)
+      when "CreateAny"
+        p_ref = arg_ref(deep_copy(op["volume"]))
+        ret = CreateAny(op["ctype"], op["disk"], p_ref)
+        p = p_ref.value
+        tdev = p.fetch("device", "")
+        if p.fetch("enc_type", :none) != :none &&
+            !save_crypt.fetch(tdev, "").empty? && GetCryptPwd(tdev).empty?
+          SetCryptPwd(tdev, save_crypt[tdev])
+        end
+        if p.fetch("type", :primary) != :extended
+          ret = ChangeVolumeProperties(p) && ret
+        end
+        ret
+      else
+        Builtins.y2error("ApplyTargetMapOperation unknown op: %1", op)
+        false
       end
-      changed = !EqualBackupStates("tmp_set", "", true)
-      Builtins.y2milestone("SetTargetMap changed: %1", changed)
-      UpdateChangeTime() if changed
-      DisposeTargetBackup("tmp_set")
-      Builtins.y2milestone("SetTargetMap ChangeTime %1", GetTargetChangeTime())
+    end
+
+
+    # Starts a target map batch. Until the matching EndTargetMapBatch the
+    # target map is not updated after every change, the update is done once
+    # when the outermost batch ends. Batches can be nested.
+    def BeginTargetMapBatch
+      @batch_level += 1
 
       nil
     end
 
+
+    # Ends a target map batch started with BeginTargetMapBatch.
+    def EndTargetMapBatch
+      @batch_level -= 1 if @batch_level > 0
+      if @batch_level == 0 && @batch_update_pending
+        @batch_update_pending = false
+        UpdateTargetMap()
+      end
+
+      nil
+    end
+
+
+    # Sorts partitions descending by number, as needed for deleting them.
+    def sorted_by_nr(partitions)
+      if partitions.size > 1 && partitions.first.has_key?("nr")
+        partitions.sort_by { |p| -p.fetch("nr", 0) }
+      else
+        partitions
+      end
+    end
+
     # Rereads the system target map and returns it
     #
     # @return [Hash{String => map}] target map
@@ -4854,23 +4985,42 @@ module Yast
       end
 
       def post_root_filesystem_create()
-        StorageSnapper::configure_snapper_step1()
+        traced("post_root_filesystem_create") { StorageSnapper::configure_snapper_step1() }
       end
 
       def post_root_mount()
-        StorageSnapper::configure_snapper_step2()
+        traced("post_root_mount") { StorageSnapper::configure_snapper_step2() }
       end
 
       def post_root_fstab_add()
-        StorageSnapper::configure_snapper_step3()
+        traced("post_root_fstab_add") { StorageSnapper::configure_snapper_step3() }
+      end
+
+      private
+
+      def traced(name)
+        StorageCallbacks.TraceBegin(name)
+        yield
+      ensure
+        StorageCallbacks.TraceEnd(name)
       end
 
     end
 
 
+    # The feature collector keeps the features of all devices between
+    # calls, so it lives as long as the storage interface.
+    def used_storage_features
+      if @used_features.nil? || !@used_features.storage.equal?(@sint)
+        @used_features = Yast::StorageHelpers::UsedStorageFeatures.new(@sint)
+      end
+      @used_features
+    end
+
+
     # return list of missing packages in the running system
     def missing_packages
-      used_features = Yast::StorageHelpers::UsedStorageFeatures.new(@sint)
+      used_features = used_storage_features
       features = used_features.collect_features
       packages = used_features.feature_packages(features)
       packages = packages.delete_if { |package| Package.Installed(package) }
@@ -4879,10 +5029,33 @@ module Yast
 
     # Apply storage changes
     #
+    # If the environment variable YAST2_STORAGE_TRACE_COMMIT is set the
+    # commit is traced and the trace is written in the Chrome trace-event
+    # format to storage-commit-trace.json in Directory.tmpdir.
+    #
     # @return [Fixnum]
     def CommitChanges
       Builtins.y2milestone("CommitChanges")
 
+      trace = ENV["YAST2_STORAGE_TRACE_COMMIT"] != nil
+      if trace
+        StorageCallbacks.StartTrace(Directory.tmpdir + "/storage-commit-trace.json")
+      end
+
+      begin
+        StorageCallbacks.TraceBegin("CommitChanges")
+        ret = commit_changes
+      ensure
+        StorageCallbacks.TraceEnd("CommitChanges")
+        StorageCallbacks.StopTrace() if trace
+      end
+
+      ret
+    end
+
+
+    def commit_changes
+
       if Mode.installation && StorageSnapper.configure_snapper?
         my_commit_callbacks = MyCommitCallbacks.new()
         @sint.setCommitCallbacks(my_commit_callbacks)
@@ -4903,7 +5076,15 @@ module Yast
         end
       end
 
-      ret = @sint.commit()
+      StorageCallbacks.TraceBegin("commit")
+      begin
+        ret = @sint.commit()
+      ensure
+        # the last action is only ended by the next one, end it inside the
+        # commit span
+        StorageCallbacks.TraceEndAction()
+        StorageCallbacks.TraceEnd("commit")
+      end
       if ret<0
         Builtins.y2error("CommitChanges sint ret: %1", ret)
       end
@@ -5681,6 +5862,66 @@ module Yast
     end
 
 
+    # Applies a list of edits to the partitions in the target map in one
+    # pass and returns the changed map. An edit is [device, key, value] to
+    # set key to value or [device, key] to remove key.
+    #
+    # @param [Hash{String => map}] tg
+    # @param [Array<Array>] edits
+    # @return [Hash{String => map}] changed target map
+    def ChangePartitionsData(tg, edits)
+      tg = deep_copy(tg)
+      return tg if Builtins.isempty(edits)
+
+      # all places a device name appears at, usually exactly one
+      index = {}
+      Builtins.foreach(tg) do |disk, data|
+        Ops.get_list(data, "partitions", []).each_with_index do |p, i|
+          (index[Ops.get_string(p, "device", "")] ||= []) << [disk, i]
+        end
+      end
+
+      places = {}
+      Builtins.foreach(edits) do |edit|
+        device = Ops.get_string(edit, 0, "")
+        key = Ops.get_string(edit, 1, "")
+
+        if !Builtins.haskey(places, device)
+          found = Ops.get_list(index, device, [])
+          if Builtins.size(found) != 1
+            # resolve like SetPartitionData does
+            tmp = Ops.get(GetDiskPartitionTg(device, tg), 0, {})
+            disk = Ops.get_string(tmp, "disk", "")
+            dev = GetDeviceName(disk, Ops.get(tmp, "nr", 0))
+            found = Builtins.filter(Ops.get_list(index, dev, [])) do |place|
+              Ops.get_string(place, 0, "") == disk
+            end
+          end
+          if Builtins.isempty(found)
+            Builtins.y2error("ChangePartitionsData unknown device %1", device)
+          end
+          places[device] = found
+        end
+
+        places[device].each do |disk, i|
+          p = tg[disk]["partitions"][i]
+          if Builtins.size(edit) > 2
+            p[key] = deep_copy(Ops.get(edit, 2))
+          else
+            p.delete(key)
+          end
+        end
+      end
+
+      Builtins.y2milestone(
+        "ChangePartitionsData %1 edits devices:%2",
+        Builtins.size(edits),
+        places.keys
+      )
+      tg
+    end
+
+
     # Check if a disk is a real disk and not RAID or LVM
     #
     # @param [Hash] entry (disk)
@@ -6008,7 +6249,7 @@ module Yast
     def AddPackageList
       packages = @hw_packages.dup # start with packages suggested by hwinfo
 
-      used_features = Yast::StorageHelpers::UsedStorageFeatures.new(@sint)
+      used_features = used_storage_features
       features = used_features.collect_features
       packages += used_features.feature_packages(features)
 
@@ -7183,8 +7424,13 @@ module Yast
     publish :function => :GetContVolInfo, :type => "boolean (string, map <string, any> &)"
     publish :function => :GetTargetMap, :type => "map <string, map> ()"
     publish :function => :SetTargetMap, :type => "void (map <string, map>)"
+    publish :function => :ApplyTargetMap, :type => "list <map> (map <string, map>)"
+    publish :function => :PlanTargetMapChanges, :type => "list <map> (map <string, map>, map <string, map>)"
+    publish :function => :BeginTargetMapBatch, :type => "void ()"
+    publish :function => :EndTargetMapBatch, :type => "void ()"
     publish :function => :SetPartitionData, :type => "map <string, map> (map <string, map>, string, string, any)"
     publish :function => :DelPartitionData, :type => "map <string, map> (map <string, map>, string, string)"
+    publish :function => :ChangePartitionsData, :type => "map <string, map> (map <string, map>, list <list>)"
     publish :function => :GetDiskPartition, :type => "map (string)"
     publish :function => :UpdateChangeTime, :type => "void ()"
     publish :function => :GetPartition, :type => "map <string, any> (map <string, map>, string)"
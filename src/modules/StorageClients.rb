@@ -225,12 +225,19 @@ module Yast
 
       @sint = value
 
-      StorageCallbacks.ProgressBar("StorageClients::ProgressBar")
-      StorageCallbacks.ShowInstallInfo("StorageClients::ShowInstallInfo")
-      StorageCallbacks.InfoPopup("StorageClients::InfoPopup")
-      StorageCallbacks.YesNoPopup("StorageClients::YesNoPopup")
-      StorageCallbacks.CommitErrorPopup("StorageClients::CommitErrorPopup")
-      StorageCallbacks.PasswordPopup("StorageClients::PasswordPopup")
+      # register the methods directly, calling them through the YCP
+      # interpreter is too slow for the frequent progress callbacks
+      StorageCallbacks.EnableRubyCallbacks
+      StorageRubyCallbacks.progress_bar(method(:ProgressBar))
+      StorageRubyCallbacks.show_install_info(method(:ShowInstallInfo))
+      StorageRubyCallbacks.info_popup(method(:InfoPopup))
+      StorageRubyCallbacks.yesno_popup(method(:YesNoPopup))
+      StorageRubyCallbacks.commit_error_popup(method(:CommitErrorPopup))
+      StorageRubyCallbacks.password_popup(method(:PasswordPopup))
+
+      # record the callbacks for replaying them with StorageCallbacks.Replay
+      record = ENV["YAST2_STORAGE_RECORD_CALLBACKS"]
+      StorageCallbacks.StartRecording(record) if record != nil
 
       nil
     end
@@ -78,9 +78,19 @@ module Yast
 
       @swapable = {}
       @ishome = {}
+
+      # proposals speculated while CommonWidgetsPopup is open, keyed by
+      # ProposalCacheKey, see get_inst_prop
+      @proposal_cache = {}
     end
 
 
+    PROPOSAL_CACHE_SIZE = 16
+
+    # milliseconds without input before the next proposal is speculated
+    SPECULATE_IDLE_MS = 300
+
+
     def SetCreateVg(val)
       @proposal_create_vg = val
       Builtins.y2milestone("SetCreateVg val: %1", @proposal_create_vg)
@@ -6156,10 +6166,75 @@ module Yast
     end
 
 
+    # Settings the proposal depends on, except the password.
+    def ProposalSettings
+      {
+        "lvm"       => @proposal_lvm,
+        "encrypt"   => @proposal_encrypt,
+        "home"      => @proposal_home,
+        "home_fs"   => @proposal_home_fs,
+        "root_fs"   => @proposal_root_fs,
+        "snapshots" => @proposal_snapshots,
+        "suspend"   => @proposal_suspend
+      }
+    end
+
+    def SetProposalSettings(settings)
+      @proposal_lvm = settings["lvm"]
+      @proposal_encrypt = settings["encrypt"]
+      @proposal_home = settings["home"]
+      @proposal_home_fs = settings["home_fs"]
+      @proposal_root_fs = settings["root_fs"]
+      @proposal_snapshots = settings["snapshots"]
+      @proposal_suspend = settings["suspend"]
+
+      nil
+    end
+
+
+    # The change time alone is not enough since it has a resolution of
+    # seconds and is not updated by every change of the target map.
+    def ProposalCacheKey(settings, target_hash)
+      [
+        settings,
+        @proposal_password,
+        @proposal_create_vg,
+        Storage.GetTargetChangeTime,
+        target_hash
+      ]
+    end
+
+
+    # Returns the proposal for the current settings. Only the first call
+    # after CommonWidgetsPopup can use a proposal speculated in the popup,
+    # the speculated proposals are dropped afterwards. All other calls
+    # compute the proposal.
     def get_inst_prop(target)
       # initialize data from control file earlier, it is needed in this function
       # to decide whether to use LVM proposal (bsc#957913)
       GetControlCfg()
+
+      if has_flex_proposal && Builtins.isempty(GetProposalVM())
+        Report.Error(
+          "The product is configured to use flexible partitioning,\n" \
+          "but that feature is not longer available.\n" \
+          "Falling back to the default partitioning proposal mechanism."
+        )
+      end
+
+      key = ProposalCacheKey(ProposalSettings(), target.hash)
+      ret = @proposal_cache[key]
+      @proposal_cache = {}
+      if ret
+        Builtins.y2milestone("get_inst_prop speculated %1", ProposalSettings())
+        return ret
+      end
+
+      compute_inst_prop(target)
+    end
+
+
+    def compute_inst_prop(target)
       target = deep_copy(target)
       ret = {}
       vg = GetProposalVM()
@@ -6171,13 +6246,6 @@ module Yast
         GetProposalEncrypt()
       )
       if Builtins.isempty(vg)
-        if has_flex_proposal
-          Report.Error(
-            "The product is configured to use flexible partitioning,\n" \
-            "but that feature is not longer available.\n" \
-            "Falling back to the default partitioning proposal mechanism."
-          )
-        end
         ret = get_inst_proposal(target)
       else
         Builtins.y2milestone("target: %1", target)
@@ -6193,6 +6261,80 @@ module Yast
     end
 
 
+    # Settings currently selected in the widgets of CommonWidgets.
+    def CommonWidgetsSettings
+      settings = ProposalSettings()
+      current = UI.QueryWidget(Id(:strategy), :CurrentButton)
+      settings["lvm"] = [:lvm, :lvm_crypt].include?(current)
+      settings["encrypt"] = current == :lvm_crypt
+      settings["root_fs"] = UI.QueryWidget(Id(:root_fs), :Value)
+      settings["snapshots"] = UI.QueryWidget(Id(:snapshots), :Value)
+      if UI.WidgetExists(Id(:home))
+        settings["home"] = UI.QueryWidget(Id(:home), :Value)
+        settings["home_fs"] = UI.QueryWidget(Id(:home_fs), :Value)
+      end
+      settings["suspend"] = UI.QueryWidget(Id(:suspend), :Value)
+      settings
+    end
+
+
+    # Settings the user is likely to choose next: the current ones and
+    # those differing by one toggle of the widgets.
+    def NeighbourSettings(settings)
+      ret = [settings]
+
+      flip = lambda do |changes|
+        ret << settings.merge(changes)
+      end
+
+      if settings["lvm"]
+        flip.call("lvm" => false, "encrypt" => false)
+      else
+        flip.call("lvm" => true, "encrypt" => false)
+      end
+      flip.call("home" => !settings["home"]) if UI.WidgetExists(Id(:home))
+      if settings["root_fs"] == :btrfs
+        flip.call("snapshots" => !settings["snapshots"])
+      end
+      if UI.QueryWidget(Id(:suspend), :Enabled)
+        flip.call("suspend" => !settings["suspend"])
+      end
+
+      # encrypted proposals set the crypt password in libstorage, which
+      # must only happen for the proposal actually used
+      ret.reject { |s| s["encrypt"] }.uniq
+    end
+
+
+    # Computes the proposal for the first settings in pending that is not
+    # cached yet and returns the remaining settings. The proposal settings
+    # are restored afterwards.
+    def SpeculateProposal(pending, target)
+      target_hash = target.hash
+      pending = Builtins.filter(pending) do |settings|
+        !@proposal_cache.key?(ProposalCacheKey(settings, target_hash))
+      end
+      return [] if Builtins.isempty(pending)
+
+      GetControlCfg()
+      saved = ProposalSettings()
+      begin
+        SetProposalSettings(pending.first)
+        Builtins.y2milestone("SpeculateProposal %1", pending.first)
+        key = ProposalCacheKey(pending.first, target_hash)
+        ret = compute_inst_prop(target)
+      ensure
+        SetProposalSettings(saved)
+      end
+
+      # the oldest entries are evicted first
+      @proposal_cache.delete(@proposal_cache.keys.first) if @proposal_cache.size >= PROPOSAL_CACHE_SIZE
+      @proposal_cache[key] = ret
+
+      pending.drop(1)
+    end
+
+
     def SaveHeight
       display_info = UI.GetDisplayInfo
       ret = false
@@ -6489,7 +6631,10 @@ module Yast
     end
 
 
-    def CommonWidgetsPopup()
+    # Asks for the proposal settings. With speculate the caller promises to
+    # reset to the on-disk target and to call get_inst_prop after OK, so
+    # the proposals can be computed while the user makes up their mind.
+    def CommonWidgetsPopup(speculate = false)
 
       UI.OpenDialog(
         Opt(:decorated),
@@ -6515,12 +6660,43 @@ module Yast
 
       UI.ChangeWidget(Id(:help), :HelpText, CommonWidgetsHelp())
 
+      # While the user makes up their mind the proposals for the current
+      # and the neighbouring settings are computed, one each time there was
+      # no input for SPECULATE_IDLE_MS, so that the proposal is ready once
+      # the popup is closed. libstorage is reset to the on-disk target
+      # during the popup, which is the state get_inst_prop runs in after
+      # OK, and the previous state is restored on cancel.
+      @proposal_cache = {}
+      pending = []
+      if speculate
+        Storage.CreateTargetBackup("speculate_proposal")
+        Storage.ResetOndiskTarget
+        target = Storage.GetTargetMap
+        pending = NeighbourSettings(CommonWidgetsSettings())
+      end
+
       begin
-        ret = Convert.to_symbol(UI.UserInput)
-        if IsCommonWidget(ret)
-          HandleCommonWidgets(ret)
+        begin
+          if Builtins.isempty(pending)
+            ret = Convert.to_symbol(UI.UserInput)
+          else
+            ret = Convert.to_symbol(UI.TimeoutUserInput(SPECULATE_IDLE_MS))
+            if ret == :timeout
+              pending = SpeculateProposal(pending, target)
+              next
+            end
+          end
+          if IsCommonWidget(ret)
+            HandleCommonWidgets(ret)
+            pending = NeighbourSettings(CommonWidgetsSettings()) if speculate
+          end
+        end until [ :ok, :cancel ].include?(ret)
+      ensure
+        if speculate
+          Storage.RestoreTargetBackup("speculate_proposal") if ret != :ok
+          Storage.DisposeTargetBackup("speculate_proposal")
         end
-      end until [ :ok, :cancel ].include?(ret)
+      end
 
       if ret == :ok
         y2milestone("setting storage proposal settings")
@@ -6530,6 +6706,8 @@ module Yast
         SetProposalHome(UI.QueryWidget(Id(:home), :Value))
         SetProposalHomeFs(UI.QueryWidget(Id(:home_fs), :Value))
         SetProposalSuspend(UI.QueryWidget(Id(:suspend), :Value))
+      else
+        @proposal_cache = {}
       end
 
       UI.CloseDialog()
@@ -6651,7 +6829,7 @@ module Yast
     publish :function => :get_proposal_vm, :type => "map <string, any> (map <string, map>, string, map)"
     publish :function => :get_inst_prop, :type => "map <string, any> (map <string, map>)"
     publish :function => :SaveHeight, :type => "boolean ()"
-    publish :function => :CommonWidgetsPopup, :type => "boolean ()"
+    publish :function => :CommonWidgetsPopup, :type => "boolean (boolean)"
     publish :function => :CouldNotDoSnapshots, :type => "boolean (map <string, map>)"
     publish :function => :CouldNotDoSeparateHome, :type => "boolean (map <string, map>)"
   end
@@ -43,169 +43,364 @@ module Yast
       @called_update = false
     end
 
-    def UpdateFstabSubfs
-      Builtins.y2milestone(
-        "UpdateFstabSubfs removing fstab entries for cdrom and floppy"
-      )
-      tabpath = Storage.PathToDestdir("/etc/fstab")
-      fstab = Partitions.GetFstab(tabpath)
-      line = 0
+    # The updates of /etc/fstab and /etc/cryptotab are expressed as steps
+    # that are applied to all lines in a single pass. A step is a map with
+    # optional entries:
+    #
+    #   "fstab"  - lambda mapping the fields of a fstab line to the new
+    #              fields, nil removes the line
+    #   "crypto" - same for cryptotab lines
+    #   "append" - lambda returning a list of fstab lines to append after
+    #              all existing lines have passed the step
+    #
+    # Steps must not modify the fields given to them.
+
+    def ChangeTabField(fields, field, entry)
+      fields = deep_copy(fields)
+      fields << "" while fields.size < field
+      fields[field] = entry
+      fields
+    end
+
+
+    # Runs the fields of one line through the given steps. Returns nil if
+    # the line is removed.
+    def ApplyTabSteps(steps, key, fields)
+      Builtins.foreach(steps) do |step|
+        next if fields == nil || !Builtins.haskey(step, key)
+        fields = step[key].call(fields)
+      end
+      deep_copy(fields)
+    end
+
+
+    # Reads tabpath once, runs all lines through the steps and writes the
+    # file once, and only if anything changed. The new contents are written
+    # to a temporary file that is renamed over the old one.
+    def RewriteTab(tabpath, key, steps)
+      tab = key == "fstab" ? Partitions.GetFstab(tabpath) : Partitions.GetCrypto(tabpath)
+
+      changes = {}
       rem_lines = []
-      while Ops.less_or_equal(line, AsciiFile.NumLines(fstab))
-        l = (
-          fstab_ref = arg_ref(fstab);
-          _GetLine_result = AsciiFile.GetLine(fstab_ref, line);
-          fstab = fstab_ref.value;
-          _GetLine_result
-        )
-        if Builtins.search(
-            Ops.get_string(l, ["fields", 1], ""),
-            "/media/floppy"
-          ) == 0
-          rem_lines = Builtins.add(rem_lines, line)
-        elsif Builtins.search(
-            Ops.get_string(l, ["fields", 1], ""),
-            "/media/cdrom"
-          ) == 0 ||
-            Builtins.search(Ops.get_string(l, ["fields", 1], ""), "/media/dvd") == 0 ||
-            Builtins.search(
-              Ops.get_string(l, ["fields", 1], ""),
-              "/media/cdrecorder"
-            ) == 0 ||
-            Builtins.search(
-              Ops.get_string(l, ["fields", 1], ""),
-              "/media/dvdrecorder"
-            ) == 0 ||
-            Builtins.search(Ops.get_string(l, ["fields", 1], ""), "/cdrom") == 0 ||
-            Builtins.search(Ops.get_string(l, ["fields", 1], ""), "/dvd") == 0 ||
-            Builtins.search(Ops.get_string(l, ["fields", 1], ""), "/cdrecorder") == 0 ||
-            Builtins.search(
-              Ops.get_string(l, ["fields", 1], ""),
-              "/dvdrecorder"
-            ) == 0
+      Ops.get_map(tab, "l", {}).keys.sort.each do |line|
+        fields = Ops.get_list(tab, ["l", line, "fields"], [])
+        next if Builtins.isempty(fields)
+        new_fields = ApplyTabSteps(steps, key, fields)
+        if new_fields == nil
           rem_lines = Builtins.add(rem_lines, line)
+        elsif new_fields != fields
+          changes[line] = new_fields
+        end
+      end
+
+      app_lines = []
+      steps.each_with_index do |step, i|
+        next if !Builtins.haskey(step, "append")
+        Builtins.foreach(step["append"].call) do |fields|
+          fields = ApplyTabSteps(Builtins.sublist(steps, Ops.add(i, 1)), key, fields)
+          app_lines = Builtins.add(app_lines, fields) if fields != nil
+        end
+      end
+
+      Builtins.y2milestone(
+        "RewriteTab %1 changed:%2 removed:%3 appended:%4",
+        tabpath,
+        changes,
+        rem_lines,
+        app_lines
+      )
+      if Builtins.isempty(changes) && Builtins.isempty(rem_lines) &&
+          Builtins.isempty(app_lines)
+        return
+      end
+
+      tab_ref = arg_ref(tab)
+      Builtins.foreach(changes) do |line, fields|
+        old = Ops.get_list(tab_ref.value, ["l", line, "fields"], [])
+        fields.each_with_index do |entry, field|
+          if entry != Ops.get_string(old, field, "")
+            AsciiFile.ChangeLineField(tab_ref, line, field, entry)
+          end
         end
-        line = Ops.add(line, 1)
       end
-      Builtins.y2milestone("UpdateFstabSubfs %1", rem_lines)
-      if Ops.greater_than(Builtins.size(rem_lines), 0)
-        rem_lines = Builtins.sort(rem_lines)
-        fstab_ref = arg_ref(fstab)
-        AsciiFile.RemoveLines(fstab_ref, rem_lines)
-        fstab = fstab_ref.value
+      # append before removing, AppendLine numbers new lines by the line count
+      Builtins.foreach(app_lines) { |fields| AsciiFile.AppendLine(tab_ref, fields) }
+      AsciiFile.RemoveLines(tab_ref, rem_lines) if !Builtins.isempty(rem_lines)
+
+      tmppath = Ops.add(tabpath, ".YaST2new")
+      AsciiFile.RewriteFile(tab_ref, tmppath)
+      tab = tab_ref.value
+      cmd = Builtins.sformat(
+        "/bin/chmod --reference='%2' '%1' 2>/dev/null; /bin/mv -f '%1' '%2'",
+        tmppath,
+        tabpath
+      )
+      if SCR.Execute(path(".target.bash"), cmd) != 0
+        Builtins.y2error("RewriteTab failed to rename %1 to %2", tmppath, tabpath)
       end
-      fstab_ref = arg_ref(fstab)
-      AsciiFile.RewriteFile(fstab_ref, tabpath)
-      fstab = fstab_ref.value
 
       nil
     end
 
 
-    def UpdateFstabSysfs
-      Builtins.y2milestone("UpdateFstabSysfs called")
-      tabpath = Storage.PathToDestdir("/etc/fstab")
-      fstab = Partitions.GetFstab(tabpath)
-      line = 0
-      have_sysfs = false
-      while !have_sysfs && Ops.less_or_equal(line, AsciiFile.NumLines(fstab))
-        l = (
-          fstab_ref = arg_ref(fstab);
-          _GetLine_result = AsciiFile.GetLine(fstab_ref, line);
-          fstab = fstab_ref.value;
-          _GetLine_result
-        )
-        have_sysfs = Ops.get_string(l, ["fields", 1], "") == "/sys"
-        line = Ops.add(line, 1)
+    # Applies the steps to /etc/fstab and /etc/cryptotab, reading and
+    # writing each file at most once.
+    def RewriteTabs(steps)
+      steps = Builtins.filter(steps) { |step| step != nil }
+
+      fstab_steps = Builtins.filter(steps) do |step|
+        Builtins.haskey(step, "fstab") || Builtins.haskey(step, "append")
+      end
+      if !Builtins.isempty(fstab_steps)
+        RewriteTab(Storage.PathToDestdir("/etc/fstab"), "fstab", fstab_steps)
       end
-      if !have_sysfs
-        entry = FileSystems.GetFstabDefaultMap("sys")
-        fstlist = [
-          Ops.get_string(entry, "spec", ""),
-          Ops.get_string(entry, "mount", ""),
-          Ops.get_string(entry, "vfstype", ""),
-          Ops.get_string(entry, "mntops", ""),
-          Builtins.sformat("%1", Ops.get_integer(entry, "freq", 0)),
-          Builtins.sformat("%1", Ops.get_integer(entry, "passno", 0))
-        ]
-        Builtins.y2milestone("UpdateFstabSysfs entry %1", entry)
-        Builtins.y2milestone("UpdateFstabSysfs fstlist %1", fstlist)
-        fstab_ref = arg_ref(fstab)
-        AsciiFile.AppendLine(fstab_ref, fstlist)
-        fstab = fstab_ref.value
-        fstab_ref = arg_ref(fstab)
-        AsciiFile.RewriteFile(fstab_ref, tabpath)
-        fstab = fstab_ref.value
+
+      crypto_steps = Builtins.filter(steps) { |step| Builtins.haskey(step, "crypto") }
+      if !Builtins.isempty(crypto_steps)
+        RewriteTab(Storage.PathToDestdir("/etc/cryptotab"), "crypto", crypto_steps)
       end
 
       nil
     end
 
 
-    def UpdateFstabHotplugOption
+    def FstabSubfsStep
+      Builtins.y2milestone(
+        "UpdateFstabSubfs removing fstab entries for cdrom and floppy"
+      )
+      prefixes = [
+        "/media/floppy",
+        "/media/cdrom",
+        "/media/dvd",
+        "/media/cdrecorder",
+        "/media/dvdrecorder",
+        "/cdrom",
+        "/dvd",
+        "/cdrecorder",
+        "/dvdrecorder"
+      ]
+      {
+        "fstab" => lambda do |fields|
+          mount = Ops.get_string(fields, 1, "")
+          if Builtins.find(prefixes) { |p| Builtins.search(mount, p) == 0 } != nil
+            Builtins.y2milestone("UpdateFstabSubfs removing %1", fields)
+            return nil
+          end
+          deep_copy(fields)
+        end
+      }
+    end
+
+
+    def FstabSysfsStep
+      Builtins.y2milestone("UpdateFstabSysfs called")
+      have_sysfs = false
+      {
+        "fstab"  => lambda do |fields|
+          have_sysfs = true if Ops.get_string(fields, 1, "") == "/sys"
+          deep_copy(fields)
+        end,
+        "append" => lambda do
+          return [] if have_sysfs
+          entry = FileSystems.GetFstabDefaultMap("sys")
+          fstlist = [
+            Ops.get_string(entry, "spec", ""),
+            Ops.get_string(entry, "mount", ""),
+            Ops.get_string(entry, "vfstype", ""),
+            Ops.get_string(entry, "mntops", ""),
+            Builtins.sformat("%1", Ops.get_integer(entry, "freq", 0)),
+            Builtins.sformat("%1", Ops.get_integer(entry, "passno", 0))
+          ]
+          Builtins.y2milestone("UpdateFstabSysfs entry %1", entry)
+          Builtins.y2milestone("UpdateFstabSysfs fstlist %1", fstlist)
+          [fstlist]
+        end
+      }
+    end
+
+
+    def FstabHotplugOptionStep
       Builtins.y2milestone("UpdateFstabHotplugOption")
-      tabpath = Storage.PathToDestdir("/etc/fstab")
-      fstab = Partitions.GetFstab(tabpath)
-      line = 0
-      n = ""
-      while Ops.less_or_equal(line, AsciiFile.NumLines(fstab))
-        l = (
-          fstab_ref = arg_ref(fstab);
-          _GetLine_result = AsciiFile.GetLine(fstab_ref, line);
-          fstab = fstab_ref.value;
-          _GetLine_result
-        )
-        options = Ops.get_string(l, ["fields", 3], "")
-        if Builtins.regexpmatch(options, "^(.*,)?hotplug(,.*)?$")
-          options = Builtins.regexpsub(
-            options,
-            "^(.*,)?hotplug(,.*)?$",
-            "\\1nofail\\2"
-          )
-          fstab_ref = arg_ref(fstab)
-          AsciiFile.ChangeLineField(fstab_ref, line, 3, options)
-          fstab = fstab_ref.value
+      {
+        "fstab" => lambda do |fields|
+          options = Ops.get_string(fields, 3, "")
+          if Builtins.regexpmatch(options, "^(.*,)?hotplug(,.*)?$")
+            options = Builtins.regexpsub(
+              options,
+              "^(.*,)?hotplug(,.*)?$",
+              "\\1nofail\\2"
+            )
+            return ChangeTabField(fields, 3, options)
+          end
+          deep_copy(fields)
         end
-        line = Ops.add(line, 1)
-      end
-      fstab_ref = arg_ref(fstab)
-      AsciiFile.RewriteFile(fstab_ref, tabpath)
-      fstab = fstab_ref.value
+      }
+    end
 
-      nil
+
+    # Step changing the device field of fstab (field 0) and cryptotab
+    # (field 1) lines to the result of the block.
+    def DeviceStep(&block)
+      {
+        "fstab"  => lambda do |fields|
+          ChangeTabField(fields, 0, block.call(Ops.get_string(fields, 0, "")))
+        end,
+        "crypto" => lambda do |fields|
+          ChangeTabField(fields, 1, block.call(Ops.get_string(fields, 1, "")))
+        end
+      }
     end
 
 
-    def UpdateFstabPersistentNames
+    def FstabPersistentNamesStep
       Builtins.y2milestone(
         "UpdateFstabPersistentDevNames updating to SLES10 names"
       )
-      tabpath = Storage.PathToDestdir("/etc/fstab")
-      fstab = Partitions.GetFstab(tabpath)
-      line = 0
-      n = ""
-      while Ops.less_or_equal(line, AsciiFile.NumLines(fstab))
-        l = (
-          fstab_ref = arg_ref(fstab);
-          _GetLine_result = AsciiFile.GetLine(fstab_ref, line);
-          fstab = fstab_ref.value;
-          _GetLine_result
-        )
-        n = Storage.SLES9PersistentDevNames(
-          Ops.get_string(l, ["fields", 0], "")
-        )
-        if n != Ops.get_string(l, ["fields", 0], "")
-          fstab_ref = arg_ref(fstab)
-          AsciiFile.ChangeLineField(fstab_ref, line, 0, n)
-          fstab = fstab_ref.value
+      step = DeviceStep { |device| Storage.SLES9PersistentDevNames(device) }
+      Builtins.remove(step, "crypto")
+    end
+
+
+    def FstabDiskmapStep(diskmap)
+      diskmap = deep_copy(diskmap)
+      Builtins.y2milestone("UpdateFstabDiskmap map %1", diskmap)
+      DeviceStep { |device| Storage.HdDiskMap(device, diskmap) }
+    end
+
+
+    def FstabUsbdevfsStep
+      Builtins.y2milestone("UpdateFstabUsbdevfs updating usbdevfs to usbfs")
+      {
+        "fstab" => lambda do |fields|
+          if Ops.get_string(fields, 2, "") == "usbdevfs"
+            Builtins.y2milestone("UpdateFstabUsbdevfs changed")
+            return ChangeTabField(ChangeTabField(fields, 2, "usbfs"), 0, "usbfs")
+          end
+          deep_copy(fields)
         end
-        line = Ops.add(line, 1)
-      end
-      fstab_ref = arg_ref(fstab)
-      AsciiFile.RewriteFile(fstab_ref, tabpath)
-      fstab = fstab_ref.value
+      }
+    end
 
-      nil
+
+    def FstabIseriesVdStep
+      Builtins.y2milestone("UpdateFstabIseriesVd updating hdx to iseries/vdx")
+      DeviceStep { |device| Storage.HdToIseries(device) }
+    end
+
+
+    def CryptoTypeStep
+      Builtins.y2milestone("UpdateCryptoType")
+      searchstr = "encryption=twofish256"
+      {
+        "fstab"  => lambda do |fields|
+          options = Ops.get_string(fields, 3, "")
+          pos = Builtins.search(options, searchstr)
+          if pos != nil
+            new = Builtins.substring(options, 0, pos)
+            new = Ops.add(new, "encryption=twofishSL92")
+            new = Ops.add(
+              new,
+              Builtins.substring(options, Ops.add(pos, Builtins.size(searchstr)))
+            )
+            Builtins.y2milestone("new options line in %1 is %2", fields, new)
+            return ChangeTabField(fields, 3, new)
+          end
+          deep_copy(fields)
+        end,
+        "crypto" => lambda do |fields|
+          if Ops.get_string(fields, 4, "") == "twofish256"
+            Builtins.y2milestone("set twofishSL92 in line %1", fields)
+            return ChangeTabField(fields, 4, "twofishSL92")
+          end
+          deep_copy(fields)
+        end
+      }
+    end
+
+
+    def FstabCryptNofailStep
+      Builtins.y2milestone("UpdateFstabCryptNofail called")
+      {
+        "fstab" => lambda do |fields|
+          if Builtins.search(Ops.get_string(fields, 0, ""), "/dev/mapper/cr_") == 0
+            ls = Builtins.splitstring(Ops.get_string(fields, 3, ""), ",")
+            ls = Builtins.filter(ls) { |s| s != "noauto" }
+            if !Builtins.contains(ls, "nofail")
+              ls = Builtins.add(ls, "nofail")
+              return ChangeTabField(fields, 3, Builtins.mergestring(ls, ","))
+            end
+          end
+          deep_copy(fields)
+        end
+      }
+    end
+
+
+    def FstabWindowsMountsStep
+      Builtins.y2milestone("UpdateFstabWindowsMounts called")
+      {
+        "fstab" => lambda do |fields|
+          mount = Ops.get_string(fields, 1, "")
+          if Builtins.search(mount, "/windows/") == 0 && Builtins.size(mount) == 10 ||
+              Builtins.search(mount, "/dos/") == 0 && Builtins.size(mount) == 6
+            Builtins.y2milestone("UpdateFstabWindowsMounts removing %1", fields)
+            return nil
+          end
+          deep_copy(fields)
+        end
+      }
+    end
+
+
+    def FstabRemoveSystemdMpsStep
+      Builtins.y2milestone("UpdateFstabRemoveSystemdMps called")
+      rem_dirs = [
+        "/proc",
+        "/sys",
+        "/sys/kernel/debug",
+        "/dev/pts",
+        "/proc/bus/usb"
+      ]
+      {
+        "fstab" => lambda do |fields|
+          if Builtins.contains(rem_dirs, Ops.get_string(fields, 1, ""))
+            Builtins.y2milestone("UpdateFstabRemoveSystemdMps removing %1", fields)
+            return nil
+          end
+          deep_copy(fields)
+        end
+      }
+    end
+
+
+    # Returns nil if there is nothing to translate.
+    def FstabDmraidToMdadmStep
+      Builtins.y2milestone("UpdateFstabDmraidToMdadm")
+
+      mapping = Storage.GetDmraidToMdadm()
+      return nil if mapping.empty?
+
+      DeviceStep { |device| Storage.TranslateDeviceDmraidToMdadm(device, mapping) }
+    end
+
+
+    def UpdateFstabSubfs
+      RewriteTabs([FstabSubfsStep()])
+    end
+
+
+    def UpdateFstabSysfs
+      RewriteTabs([FstabSysfsStep()])
+    end
+
+
+    def UpdateFstabHotplugOption
+      RewriteTabs([FstabHotplugOptionStep()])
+    end
+
+
+    def UpdateFstabPersistentNames
+      RewriteTabs([FstabPersistentNamesStep()])
     end
 
 
@@ -250,380 +445,39 @@ module Yast
 
 
     def UpdateFstabDiskmap(diskmap)
-      diskmap = deep_copy(diskmap)
-      Builtins.y2milestone("UpdateFstabDiskmap map %1", diskmap)
-      tabpath = Storage.PathToDestdir("/etc/fstab")
-      fstab = Partitions.GetFstab(tabpath)
-      line = 0
-      n = ""
-      while Ops.less_or_equal(line, AsciiFile.NumLines(fstab))
-        l = (
-          fstab_ref = arg_ref(fstab);
-          _GetLine_result = AsciiFile.GetLine(fstab_ref, line);
-          fstab = fstab_ref.value;
-          _GetLine_result
-        )
-        n = Storage.HdDiskMap(Ops.get_string(l, ["fields", 0], ""), diskmap)
-        if n != Ops.get_string(l, ["fields", 0], "")
-          fstab_ref = arg_ref(fstab)
-          AsciiFile.ChangeLineField(fstab_ref, line, 0, n)
-          fstab = fstab_ref.value
-        end
-        line = Ops.add(line, 1)
-      end
-      fstab_ref = arg_ref(fstab)
-      AsciiFile.RewriteFile(fstab_ref, tabpath)
-      fstab = fstab_ref.value
-      tabpath = Storage.PathToDestdir("/etc/cryptotab")
-      crtab = Partitions.GetCrypto(tabpath)
-      line = 0
-      while Ops.less_or_equal(line, AsciiFile.NumLines(crtab))
-        l = (
-          crtab_ref = arg_ref(crtab);
-          _GetLine_result = AsciiFile.GetLine(crtab_ref, line);
-          crtab = crtab_ref.value;
-          _GetLine_result
-        )
-        n = Storage.HdDiskMap(Ops.get_string(l, ["fields", 1], ""), diskmap)
-        if n != Ops.get_string(l, ["fields", 1], "")
-          crtab_ref = arg_ref(crtab)
-          AsciiFile.ChangeLineField(crtab_ref, line, 1, n)
-          crtab = crtab_ref.value
-        end
-        line = Ops.add(line, 1)
-      end
-      crtab_ref = arg_ref(crtab)
-      AsciiFile.RewriteFile(crtab_ref, tabpath)
-      crtab = crtab_ref.value
-
-      nil
+      RewriteTabs([FstabDiskmapStep(diskmap)])
     end
 
 
     def UpdateFstabUsbdevfs
-      Builtins.y2milestone("UpdateFstabUsbdevfs updating usbdevfs to usbfs")
-      changed = false
-      tabpath = Storage.PathToDestdir("/etc/fstab")
-      fstab = Partitions.GetFstab(tabpath)
-      line = 0
-      while Ops.less_or_equal(line, AsciiFile.NumLines(fstab))
-        l = (
-          fstab_ref = arg_ref(fstab);
-          _GetLine_result = AsciiFile.GetLine(fstab_ref, line);
-          fstab = fstab_ref.value;
-          _GetLine_result
-        )
-        if Ops.get_string(l, ["fields", 2], "") == "usbdevfs"
-          fstab_ref = arg_ref(fstab)
-          AsciiFile.ChangeLineField(fstab_ref, line, 2, "usbfs")
-          fstab = fstab_ref.value
-          fstab_ref = arg_ref(fstab)
-          AsciiFile.ChangeLineField(fstab_ref, line, 0, "usbfs")
-          fstab = fstab_ref.value
-          changed = true
-        end
-        line = Ops.add(line, 1)
-      end
-      if changed
-        Builtins.y2milestone("UpdateFstabUsbdevfs changed")
-        fstab_ref = arg_ref(fstab)
-        AsciiFile.RewriteFile(fstab_ref, tabpath)
-        fstab = fstab_ref.value
-      end
-
-      nil
+      RewriteTabs([FstabUsbdevfsStep()])
     end
 
 
     def UpdateFstabIseriesVd
-      Builtins.y2milestone("UpdateFstabIseriesVd updating hdx to iseries/vdx")
-      tabpath = Storage.PathToDestdir("/etc/fstab")
-      fstab = Partitions.GetFstab(tabpath)
-      line = 0
-      n = ""
-      while Ops.less_or_equal(line, AsciiFile.NumLines(fstab))
-        l = (
-          fstab_ref = arg_ref(fstab);
-          _GetLine_result = AsciiFile.GetLine(fstab_ref, line);
-          fstab = fstab_ref.value;
-          _GetLine_result
-        )
-        n = Storage.HdToIseries(Ops.get_string(l, ["fields", 0], ""))
-        if n != Ops.get_string(l, ["fields", 0], "")
-          fstab_ref = arg_ref(fstab)
-          AsciiFile.ChangeLineField(fstab_ref, line, 0, n)
-          fstab = fstab_ref.value
-        end
-        line = Ops.add(line, 1)
-      end
-      fstab_ref = arg_ref(fstab)
-      AsciiFile.RewriteFile(fstab_ref, tabpath)
-      fstab = fstab_ref.value
-      tabpath = Storage.PathToDestdir("/etc/cryptotab")
-      crtab = Partitions.GetCrypto(tabpath)
-      line = 0
-      while Ops.less_or_equal(line, AsciiFile.NumLines(crtab))
-        l = (
-          crtab_ref = arg_ref(crtab);
-          _GetLine_result = AsciiFile.GetLine(crtab_ref, line);
-          crtab = crtab_ref.value;
-          _GetLine_result
-        )
-        n = Storage.HdToIseries(Ops.get_string(l, ["fields", 1], ""))
-        if n != Ops.get_string(l, ["fields", 1], "")
-          crtab_ref = arg_ref(crtab)
-          AsciiFile.ChangeLineField(crtab_ref, line, 1, n)
-          crtab = crtab_ref.value
-        end
-        line = Ops.add(line, 1)
-      end
-      crtab_ref = arg_ref(crtab)
-      AsciiFile.RewriteFile(crtab_ref, tabpath)
-      crtab = crtab_ref.value
-
-      nil
+      RewriteTabs([FstabIseriesVdStep()])
     end
 
 
     def UpdateCryptoType
-      Builtins.y2milestone("UpdateCryptoType")
-      tabpath = Storage.PathToDestdir("/etc/fstab")
-      fstab = Partitions.GetFstab(tabpath)
-      line = 0
-      pos = 0
-      searchstr = "encryption=twofish256"
-      while Ops.less_or_equal(line, AsciiFile.NumLines(fstab))
-        l = (
-          fstab_ref = arg_ref(fstab);
-          _GetLine_result = AsciiFile.GetLine(fstab_ref, line);
-          fstab = fstab_ref.value;
-          _GetLine_result
-        )
-        pos = Builtins.search(Ops.get_string(l, ["fields", 3], ""), searchstr)
-        if pos != nil
-          new = Builtins.substring(Ops.get_string(l, ["fields", 3], ""), 0, pos)
-          new = Ops.add(new, "encryption=twofishSL92")
-          new = Ops.add(
-            new,
-            Builtins.substring(
-              Ops.get_string(l, ["fields", 3], ""),
-              Ops.add(pos, Builtins.size(searchstr))
-            )
-          )
-          Builtins.y2milestone("new options line in %1 is %2", l, new)
-          fstab_ref = arg_ref(fstab)
-          AsciiFile.ChangeLineField(fstab_ref, line, 3, new)
-          fstab = fstab_ref.value
-        end
-        line = Ops.add(line, 1)
-      end
-      fstab_ref = arg_ref(fstab)
-      AsciiFile.RewriteFile(fstab_ref, tabpath)
-      fstab = fstab_ref.value
-      tabpath = Storage.PathToDestdir("/etc/cryptotab")
-      crtab = Partitions.GetCrypto(tabpath)
-      line = 0
-      while Ops.less_or_equal(line, AsciiFile.NumLines(crtab))
-        l = (
-          crtab_ref = arg_ref(crtab);
-          _GetLine_result = AsciiFile.GetLine(crtab_ref, line);
-          crtab = crtab_ref.value;
-          _GetLine_result
-        )
-        if Ops.get_string(l, ["fields", 4], "") == "twofish256"
-          Builtins.y2milestone("set twofishSL92 in line %1", l)
-          crtab_ref = arg_ref(crtab)
-          AsciiFile.ChangeLineField(crtab_ref, line, 4, "twofishSL92")
-          crtab = crtab_ref.value
-        end
-        line = Ops.add(line, 1)
-      end
-      crtab_ref = arg_ref(crtab)
-      AsciiFile.RewriteFile(crtab_ref, tabpath)
-      crtab = crtab_ref.value
-
-      nil
+      RewriteTabs([CryptoTypeStep()])
     end
 
     def UpdateFstabCryptNofail
-      Builtins.y2milestone("UpdateFstabCryptNofail called")
-      tabpath = Storage.PathToDestdir("/etc/fstab")
-      fstab = Partitions.GetFstab(tabpath)
-      line = 0
-      update = false
-      while Ops.less_or_equal(line, AsciiFile.NumLines(fstab))
-        l = (
-          fstab_ref = arg_ref(fstab);
-          _GetLine_result = AsciiFile.GetLine(fstab_ref, line);
-          fstab = fstab_ref.value;
-          _GetLine_result
-        )
-        if Builtins.search(
-            Ops.get_string(l, ["fields", 0], ""),
-            "/dev/mapper/cr_"
-          ) == 0
-          ls = Builtins.splitstring(Ops.get_string(l, ["fields", 3], ""), ",")
-          ls = Builtins.filter(ls) { |s| s != "noauto" }
-          if Builtins.size(Builtins.filter(ls) { |s| s == "nofail" }) == 0
-            ls = Builtins.add(ls, "nofail")
-            fstab_ref = arg_ref(fstab)
-            AsciiFile.ChangeLineField(
-              fstab_ref,
-              line,
-              3,
-              Builtins.mergestring(ls, ",")
-            )
-            fstab = fstab_ref.value
-            update = true
-          end
-        end
-        line = Ops.add(line, 1)
-      end
-      if update
-        fstab_ref = arg_ref(fstab)
-        AsciiFile.RewriteFile(fstab_ref, tabpath)
-        fstab = fstab_ref.value
-      end
-
-      nil
+      RewriteTabs([FstabCryptNofailStep()])
     end
 
     def UpdateFstabWindowsMounts
-      Builtins.y2milestone("UpdateFstabWindowsMounts called")
-      tabpath = Storage.PathToDestdir("/etc/fstab")
-      fstab = Partitions.GetFstab(tabpath)
-      rem_lines = []
-      line = 0
-      while Ops.less_or_equal(line, AsciiFile.NumLines(fstab))
-        l = (
-          fstab_ref = arg_ref(fstab);
-          _GetLine_result = AsciiFile.GetLine(fstab_ref, line);
-          fstab = fstab_ref.value;
-          _GetLine_result
-        )
-        if Builtins.search(Ops.get_string(l, ["fields", 1], ""), "/windows/") == 0 &&
-            Builtins.size(Ops.get_string(l, ["fields", 1], "")) == 10 ||
-            Builtins.search(Ops.get_string(l, ["fields", 1], ""), "/dos/") == 0 &&
-              Builtins.size(Ops.get_string(l, ["fields", 1], "")) == 6
-          rem_lines = Builtins.add(rem_lines, line)
-        end
-        line = Ops.add(line, 1)
-      end
-      if Ops.greater_than(Builtins.size(rem_lines), 0)
-        rem_lines = Builtins.sort(rem_lines)
-        Builtins.y2milestone("UpdateFstabWindowsMounts %1", rem_lines)
-        fstab_ref = arg_ref(fstab)
-        AsciiFile.RemoveLines(fstab_ref, rem_lines)
-        fstab = fstab_ref.value
-        fstab_ref = arg_ref(fstab)
-        AsciiFile.RewriteFile(fstab_ref, tabpath)
-        fstab = fstab_ref.value
-      end
-
-      nil
+      RewriteTabs([FstabWindowsMountsStep()])
     end
 
     def UpdateFstabRemoveSystemdMps
-      Builtins.y2milestone("UpdateFstabRemoveSystemdMps called")
-      tabpath = Storage.PathToDestdir("/etc/fstab")
-      fstab = Partitions.GetFstab(tabpath)
-      rem_lines = []
-      rem_dirs = [
-        "/proc",
-        "/sys",
-        "/sys/kernel/debug",
-        "/dev/pts",
-        "/proc/bus/usb"
-      ]
-      line = 0
-      while Ops.less_or_equal(line, AsciiFile.NumLines(fstab))
-        l = (
-          fstab_ref = arg_ref(fstab);
-          _GetLine_result = AsciiFile.GetLine(fstab_ref, line);
-          fstab = fstab_ref.value;
-          _GetLine_result
-        )
-        if Builtins.contains(rem_dirs, Ops.get_string(l, ["fields", 1], ""))
-          rem_lines = Builtins.add(rem_lines, line)
-        end
-        line = Ops.add(line, 1)
-      end
-      if Ops.greater_than(Builtins.size(rem_lines), 0)
-        rem_lines = Builtins.sort(rem_lines)
-        Builtins.y2milestone("UpdateFstabRemoveSystemdMps %1", rem_lines)
-        fstab_ref = arg_ref(fstab)
-        AsciiFile.RemoveLines(fstab_ref, rem_lines)
-        fstab = fstab_ref.value
-        fstab_ref = arg_ref(fstab)
-        AsciiFile.RewriteFile(fstab_ref, tabpath)
-        fstab = fstab_ref.value
-      end
-
-      nil
+      RewriteTabs([FstabRemoveSystemdMpsStep()])
     end
 
 
     def UpdateFstabDmraidToMdadm()
-      Builtins.y2milestone("UpdateFstabDmraidToMdadm")
-
-      mapping = Storage.GetDmraidToMdadm()
-      if mapping.empty?
-        return
-      end
-
-      fstab_path = Storage.PathToDestdir("/etc/fstab")
-      fstab = Partitions.GetFstab(fstab_path)
-
-      for line in 1..AsciiFile.NumLines(fstab)
-        l = (
-          fstab_ref = arg_ref(fstab);
-          _GetLine_result = AsciiFile.GetLine(fstab_ref, line);
-          fstab = fstab_ref.value;
-          _GetLine_result
-        )
-
-        device = Ops.get_string(l, ["fields", 0], "")
-
-        device = Storage.TranslateDeviceDmraidToMdadm(device, mapping)
-
-        if device != Ops.get_string(l, ["fields", 0], "")
-          fstab_ref = arg_ref(fstab)
-          AsciiFile.ChangeLineField(fstab_ref, line, 0, device)
-          fstab = fstab_ref.value
-        end
-      end
-
-      fstab_ref = arg_ref(fstab)
-      AsciiFile.RewriteFile(fstab_ref, fstab_path)
-      fstab = fstab_ref.value
-
-      crtab_path = Storage.PathToDestdir("/etc/cryptotab")
-      crtab = Partitions.GetCrypto(crtab_path)
-
-      for line in 1..AsciiFile.NumLines(crtab)
-        l = (
-          crtab_ref = arg_ref(crtab);
-          _GetLine_result = AsciiFile.GetLine(crtab_ref, line);
-          crtab = crtab_ref.value;
-          _GetLine_result
-        )
-
-        device = Ops.get_string(l, ["fields", 1], "")
-
-        device = Storage.TranslateDeviceDmraidToMdadm(device, mapping)
-
-        if device != Ops.get_string(l, ["fields", 1], "")
-          crtab_ref = arg_ref(crtab)
-          AsciiFile.ChangeLineField(crtab_ref, line, 1, device)
-          crtab = crtab_ref.value
-        end
-      end
-
-      crtab_ref = arg_ref(crtab)
-      AsciiFile.RewriteFile(crtab_ref, crtab_path)
-      crtab = crtab_ref.value
-
-      return
+      RewriteTabs([FstabDmraidToMdadmStep()])
     end
 
 
@@ -677,29 +531,33 @@ module Yast
           Builtins.y2error("Missing key major or minor")
         end
 
+        # fstab and cryptotab steps are collected in the order they have to
+        # be applied and run in one pass at the end
+        steps = []
+
         if Ops.less_or_equal(Ops.get_integer(oldv, "major", 0), 9)
-          UpdateFstabSysfs()
+          steps << FstabSysfsStep()
         end
         if Ops.less_than(Ops.get_integer(oldv, "major", 0), 9)
-          UpdateFstabUsbdevfs()
+          steps << FstabUsbdevfsStep()
         end
-        UpdateFstabPersistentNames() if Ops.get_integer(oldv, "major", 0) == 9
+        steps << FstabPersistentNamesStep() if Ops.get_integer(oldv, "major", 0) == 9
 
         if Ops.less_or_equal(Ops.get_integer(oldv, "major", 0), 10)
-          UpdateFstabHotplugOption()
+          steps << FstabHotplugOptionStep()
         end
 
-        UpdateFstabDmraidToMdadm()
+        steps << FstabDmraidToMdadmStep()
 
         dm = Storage.BuildDiskmap(oldv)
         if Ops.greater_than(Builtins.size(dm), 0)
-          UpdateFstabDiskmap(dm)
+          steps << FstabDiskmapStep(dm)
           UpdateMdadm()
         end
         if Ops.less_than(Ops.get_integer(oldv, "major", 0), 9) ||
             Ops.get_integer(oldv, "major", 0) == 9 &&
               Ops.less_or_equal(Ops.get_integer(oldv, "minor", 0), 2)
-          UpdateCryptoType()
+          steps << CryptoTypeStep()
         end
         if Ops.less_than(Ops.get_integer(oldv, "major", 0), 10) ||
             Ops.get_integer(oldv, "major", 0) == 10 &&
@@ -721,12 +579,12 @@ module Yast
         if Ops.less_than(Ops.get_integer(oldv, "major", 0), 10) ||
             Ops.get_integer(oldv, "major", 0) == 10 &&
               Ops.get_integer(oldv, "minor", 0) == 0
-          UpdateFstabSubfs()
+          steps << FstabSubfsStep()
         end
         if Ops.less_than(Ops.get_integer(oldv, "major", 0), 9) ||
             Ops.get_integer(oldv, "major", 0) == 9 &&
               Ops.get_integer(oldv, "minor", 0) == 0
-          UpdateFstabIseriesVd() if Arch.board_iseries
+          steps << FstabIseriesVdStep() if Arch.board_iseries
         end
         if Ops.less_than(Ops.get_integer(oldv, "major", 0), 10) ||
             Ops.get_integer(oldv, "major", 0) == 10 &&
@@ -742,13 +600,16 @@ module Yast
         if Ops.less_than(Ops.get_integer(oldv, "major", 0), 11) ||
             Ops.get_integer(oldv, "major", 0) == 11 &&
               Ops.less_or_equal(Ops.get_integer(oldv, "minor", 0), 2)
-          UpdateFstabCryptNofail()
+          steps << FstabCryptNofailStep()
         end
         # 	    if( oldv["major"]:0<=11 || (oldv["major"]:0==12 && oldv["minor"]:0<=1))
         # 		UpdateFstabWindowsMounts();
         if Ops.less_than(Ops.get_integer(oldv, "major", 0), 13)
-          UpdateFstabRemoveSystemdMps()
+          steps << FstabRemoveSystemdMpsStep()
         end
+
+        RewriteTabs(steps)
+
         # set flag -> it indicates that Update was already called
         @called_update = true
       else
@@ -0,0 +1,49 @@
+#!/usr/bin/env rspec
+
+require_relative "spec_helper"
+
+Yast.import "FileSystems"
+Yast.import "StorageInit"
+
+
+describe "FileSystems#FsCapability" do
+
+  subject { Yast::FileSystems }
+
+  let(:sint) { double("storage") }
+
+  let(:caps) do
+    double("caps", isExtendable: true, isExtendableWhileMounted: true,
+      isReduceable: false, isReduceableWhileMounted: false, supportsUuid: true,
+      supportsLabel: true, labelWhileMounted: true, labelLength: 16,
+      minimalFsSizeK: 1024)
+  end
+
+  before do
+    # a module that was never initialized with InitSlib
+    subject.instance_variable_set(:@sint, nil)
+    subject.instance_variable_set(:@fs_capabilities, nil)
+    subject.instance_variable_set(:@fs_ids, {})
+
+    allow(Yast::StorageInit).to receive(:CreateInterface).and_return(sint)
+    allow(::Storage::FsCapabilities).to receive(:new).and_return(caps)
+    allow(sint).to receive(:getFsCapabilities) { |id, _caps| id == ::Storage::EXT4 }
+  end
+
+
+  it "builds the capabilities on first use" do
+    expect(subject.FsCapability(:ext4)).to include("min_size_k" => 1024, "uuid" => true)
+  end
+
+
+  it "returns the capabilities for the first query" do
+    expect(subject.MinFsSizeK(:ext4)).to eq(1024)
+    expect(subject.MountUuid(:ext4)).to eq(true)
+  end
+
+
+  it "returns no capabilities for unknown filesystems" do
+    expect(subject.FsCapability(:xfs)).to eq({})
+  end
+
+end
@@ -41,4 +41,26 @@ describe Yast::Partitions do
       end
     end
   end
+
+  describe "fsid predicates" do
+    it "classifies windows partition ids" do
+      expect(partitions.IsDosPartition(12)).to eq(true)
+      expect(partitions.IsDosPartition(7)).to eq(false)
+      expect(partitions.IsDosWinNtPartition(7)).to eq(true)
+      expect(partitions.IsLinuxPartition(12)).to eq(false)
+    end
+
+    it "classifies linux partition ids" do
+      expect(partitions.IsLinuxPartition(partitions.fsid_lvm)).to eq(true)
+      expect(partitions.IsSwapPartition(partitions.fsid_swap)).to eq(true)
+      expect(partitions.IsResizable(partitions.fsid_lvm)).to eq(false)
+      expect(partitions.IsResizable(partitions.fsid_gpt_boot)).to eq(true)
+    end
+
+    it "handles unknown partition ids" do
+      expect(partitions.IsResizable(4711)).to eq(false)
+      expect(partitions.IsPrepPartition(-1)).to eq(false)
+      expect(partitions.IsExtendedPartition(nil)).to eq(false)
+    end
+  end
 end
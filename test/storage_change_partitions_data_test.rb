@@ -0,0 +1,88 @@
+#!/usr/bin/env rspec
+
+require_relative "spec_helper"
+
+Yast.import "Storage"
+
+
+describe "Storage#ChangePartitionsData" do
+
+  let(:tg) do
+    {
+      "/dev/sda" => {
+        "device" => "/dev/sda",
+        "partitions" => [
+          { "device" => "/dev/sda1", "nr" => 1, "mount" => "swap" },
+          { "device" => "/dev/sda2", "nr" => 2, "used_fs" => :ext4 }
+        ]
+      },
+      "/dev/sdb" => {
+        "device" => "/dev/sdb",
+        "partitions" => [
+          { "device" => "/dev/sdb1", "nr" => 1 }
+        ]
+      }
+    }
+  end
+
+
+  it "sets and removes keys of several partitions" do
+    ret = Yast::Storage.ChangePartitionsData(tg, [
+      ["/dev/sda1", "mount"],
+      ["/dev/sda2", "used_fs", :btrfs],
+      ["/dev/sda2", "subvol", [{ "name" => "@" }]],
+      ["/dev/sdb1", "mount", "/home"]
+    ])
+
+    expect(ret["/dev/sda"]["partitions"]).to eq(
+      [
+        { "device" => "/dev/sda1", "nr" => 1 },
+        { "device" => "/dev/sda2", "nr" => 2, "used_fs" => :btrfs, "subvol" => [{ "name" => "@" }] }
+      ]
+    )
+    expect(ret["/dev/sdb"]["partitions"]).to eq(
+      [{ "device" => "/dev/sdb1", "nr" => 1, "mount" => "/home" }]
+    )
+  end
+
+
+  it "changes only the partition if a btrfs volume has the same name" do
+    tg["/dev/btrfs"] = {
+      "device" => "/dev/btrfs",
+      "partitions" => [
+        { "device" => "/dev/sda2", "used_fs" => :btrfs, "subvol" => [] }
+      ]
+    }
+    allow(Yast::Storage).to receive(:GetDeviceName).with("/dev/sda", 2).and_return("/dev/sda2")
+
+    ret = Yast::Storage.ChangePartitionsData(tg, [["/dev/sda2", "mount", "/"]])
+
+    expect(ret["/dev/sda"]["partitions"][1]).to eq(
+      { "device" => "/dev/sda2", "nr" => 2, "used_fs" => :ext4, "mount" => "/" }
+    )
+    expect(ret["/dev/btrfs"]["partitions"]).to eq(
+      [{ "device" => "/dev/sda2", "used_fs" => :btrfs, "subvol" => [] }]
+    )
+  end
+
+
+  it "does not share the stored values with the caller" do
+    subvol = [{ "name" => "@" }]
+    ret = Yast::Storage.ChangePartitionsData(tg, [
+      ["/dev/sda2", "subvol", subvol],
+      ["/dev/sdb1", "subvol", subvol]
+    ])
+    subvol << { "name" => "@/home" }
+    ret["/dev/sda"]["partitions"][1]["subvol"] << { "name" => "@/var" }
+
+    expect(ret["/dev/sda"]["partitions"][1]["subvol"]).to eq([{ "name" => "@" }, { "name" => "@/var" }])
+    expect(ret["/dev/sdb"]["partitions"][0]["subvol"]).to eq([{ "name" => "@" }])
+  end
+
+
+  it "does not modify the given target map" do
+    Yast::Storage.ChangePartitionsData(tg, [["/dev/sda1", "mount"]])
+    expect(tg["/dev/sda"]["partitions"][0]["mount"]).to eq("swap")
+  end
+
+end
@@ -0,0 +1,89 @@
+#!/usr/bin/env rspec
+
+require_relative "spec_helper"
+
+Yast.import "Storage"
+
+
+describe "Storage#PlanTargetMapChanges" do
+
+  let(:tg) do
+    {
+      "/dev/sda" => {
+        "device" => "/dev/sda",
+        "type" => :CT_DISK,
+        "partitions" => [
+          { "device" => "/dev/sda1", "nr" => 1 },
+          { "device" => "/dev/sda2", "nr" => 2 },
+          { "device" => "/dev/sda3", "nr" => 3 }
+        ]
+      }
+    }
+  end
+
+  def operations(ops)
+    ops.map { |op| [op["operation"], op["device"]] }
+  end
+
+
+  it "only changes the properties of existing volumes" do
+    expect(operations(Yast::Storage.PlanTargetMapChanges(tg, tg))).to eq(
+      [
+        ["ChangeVolumeProperties", "/dev/sda1"],
+        ["ChangeVolumeProperties", "/dev/sda2"],
+        ["ChangeVolumeProperties", "/dev/sda3"]
+      ]
+    )
+  end
+
+
+  it "deletes partitions descending and creates them ascending" do
+    target = Yast.deep_copy(tg)
+    target["/dev/sda"]["partitions"] = [
+      { "device" => "/dev/sda2", "nr" => 2, "delete" => true },
+      { "device" => "/dev/sda3", "nr" => 3, "delete" => true },
+      { "device" => "/dev/sda5", "nr" => 5, "create" => true, "type" => :logical },
+      { "device" => "/dev/sda4", "nr" => 4, "create" => true, "type" => :extended }
+    ]
+
+    expect(operations(Yast::Storage.PlanTargetMapChanges(target, tg))).to eq(
+      [
+        ["DeleteDevice", "/dev/sda3"],
+        ["DeleteDevice", "/dev/sda2"],
+        ["CreateAny", "/dev/sda4"],
+        ["CreateAny", "/dev/sda5"]
+      ]
+    )
+  end
+
+
+  it "creates volume groups before their logical volumes and after the disks" do
+    target = Yast.deep_copy(tg)
+    target["/dev/sda"]["partitions"] = [
+      { "device" => "/dev/sda4", "nr" => 4, "create" => true }
+    ]
+    target["/dev/system"] = {
+      "device" => "/dev/system",
+      "name" => "system",
+      "type" => :CT_LVM,
+      "create" => true,
+      "devices" => ["/dev/sda4"],
+      "partitions" => [
+        { "device" => "/dev/system/root", "name" => "root", "create" => true, "type" => :lvm },
+        { "device" => "/dev/system/pool", "name" => "pool", "create" => true, "type" => :lvm,
+          "pool" => true }
+      ]
+    }
+
+    expect(operations(Yast::Storage.PlanTargetMapChanges(target, tg))).to eq(
+      [
+        ["CreateAny", "/dev/sda4"],
+        ["CreateLvmVg", "/dev/system"],
+        ["ExtendLvmVg", "/dev/sda4"],
+        ["CreateAny", "/dev/system/pool"],
+        ["CreateAny", "/dev/system/root"]
+      ]
+    )
+  end
+
+end
@@ -0,0 +1,73 @@
+#!/usr/bin/env rspec
+
+require_relative "spec_helper"
+
+Yast.import "StorageProposal"
+Yast.import "Storage"
+Yast.import "Report"
+
+
+describe "StorageProposal#get_inst_prop" do
+
+  subject { Yast::StorageProposal }
+
+  let(:target) { { "/dev/sda" => { "device" => "/dev/sda", "partitions" => [] } } }
+
+  before do
+    allow(subject).to receive(:GetControlCfg).and_return({})
+    allow(Yast::Storage).to receive(:GetTargetChangeTime).and_return(42)
+    allow(subject).to receive(:compute_inst_prop) { |t| { "ok" => true, "target" => t } }
+    subject.SetProposalLvm(false)
+    subject.SetProposalHome(true)
+    subject.instance_variable_set(:@proposal_cache, {})
+  end
+
+
+  it "computes the proposal on every call" do
+    expect(subject).to receive(:compute_inst_prop).twice
+    subject.get_inst_prop(target)
+    subject.get_inst_prop(target)
+  end
+
+
+  it "uses a speculated proposal once" do
+    expect(subject).to receive(:compute_inst_prop).twice
+    subject.SpeculateProposal([subject.ProposalSettings], target)
+    expect(subject.get_inst_prop(target)).to eq({ "ok" => true, "target" => target })
+    subject.get_inst_prop(target)
+  end
+
+
+  it "does not use a proposal speculated for other settings" do
+    other = subject.ProposalSettings.merge("home" => false)
+    expect(subject).to receive(:compute_inst_prop).twice
+    expect(subject.SpeculateProposal([other], target)).to eq([])
+    subject.get_inst_prop(target)
+  end
+
+
+  it "does not use a proposal speculated for another target map" do
+    other = { "/dev/sdb" => { "device" => "/dev/sdb", "partitions" => [] } }
+    expect(subject).to receive(:compute_inst_prop).twice
+    subject.SpeculateProposal([subject.ProposalSettings], target)
+    subject.get_inst_prop(other)
+  end
+
+
+  it "warns about flexible partitioning only when the proposal is used" do
+    allow(subject).to receive(:has_flex_proposal).and_return(true)
+    allow(subject).to receive(:GetProposalVM).and_return("")
+    expect(Yast::Report).to receive(:Error).once
+    subject.SpeculateProposal([subject.ProposalSettings], target)
+    subject.get_inst_prop(target)
+  end
+
+
+  it "speculates each settings only once" do
+    settings = subject.ProposalSettings
+    expect(subject).to receive(:compute_inst_prop).once
+    subject.SpeculateProposal([settings], target)
+    expect(subject.SpeculateProposal([settings], target)).to eq([])
+  end
+
+end
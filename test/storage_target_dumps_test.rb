@@ -0,0 +1,45 @@
+#!/usr/bin/env rspec
+
+require_relative "spec_helper"
+
+Yast.import "Storage"
+
+
+describe "Storage#TargetDumpsToPrune" do
+
+  let(:dumps) do
+    [
+      ["/tmp/targetMap_s_initial_0", 100],
+      ["/tmp/targetMap_s_tmp_set_1", 200],
+      ["/tmp/targetMap_r_initial", 300],
+      ["/tmp/targetMap_s_disk_2", 400]
+    ]
+  end
+
+
+  it "keeps all dumps within the limits" do
+    expect(Yast::Storage.TargetDumpsToPrune(dumps, 4, 1000)).to eq([])
+  end
+
+
+  it "removes the oldest dumps above the count limit" do
+    expect(Yast::Storage.TargetDumpsToPrune(dumps, 2, 1000)).to eq(
+      ["/tmp/targetMap_s_initial_0", "/tmp/targetMap_s_tmp_set_1"]
+    )
+  end
+
+
+  it "removes the oldest dumps above the size limit" do
+    expect(Yast::Storage.TargetDumpsToPrune(dumps, 4, 750)).to eq(
+      ["/tmp/targetMap_s_initial_0", "/tmp/targetMap_s_tmp_set_1"]
+    )
+  end
+
+
+  it "always keeps the newest dump" do
+    expect(Yast::Storage.TargetDumpsToPrune(dumps, 1, 10)).to eq(
+      ["/tmp/targetMap_s_initial_0", "/tmp/targetMap_s_tmp_set_1", "/tmp/targetMap_r_initial"]
+    )
+  end
+
+end
@@ -0,0 +1,49 @@
+#!/usr/bin/env rspec
+
+require_relative "spec_helper"
+
+Yast.import "StorageUpdate"
+
+
+describe "StorageUpdate#ApplyTabSteps" do
+
+  subject { Yast::StorageUpdate }
+
+  let(:steps) do
+    [
+      subject.FstabHotplugOptionStep,
+      subject.FstabCryptNofailStep,
+      subject.FstabRemoveSystemdMpsStep
+    ]
+  end
+
+
+  it "applies all steps to one line" do
+    expect(subject.ApplyTabSteps(steps, "fstab",
+      ["/dev/mapper/cr_home", "/home", "ext4", "noauto,hotplug", "0", "2"])).to eq(
+      ["/dev/mapper/cr_home", "/home", "ext4", "noauto,nofail", "0", "2"]
+    )
+  end
+
+
+  it "keeps lines no step changes" do
+    line = ["/dev/sda1", "/", "ext4", "defaults", "1", "1"]
+    expect(subject.ApplyTabSteps(steps, "fstab", line)).to eq(line)
+  end
+
+
+  it "removes lines and skips the remaining steps" do
+    expect(subject.ApplyTabSteps(steps, "fstab",
+      ["proc", "/proc", "proc", "defaults", "0", "0"])).to be_nil
+  end
+
+
+  it "ignores steps for the other file" do
+    line = ["cr_home", "/dev/sda2", "/home", "ext4", "twofish256", ""]
+    expect(subject.ApplyTabSteps(steps, "crypto", line)).to eq(line)
+    expect(subject.ApplyTabSteps([subject.CryptoTypeStep], "crypto", line)).to eq(
+      ["cr_home", "/dev/sda2", "/home", "ext4", "twofishSL92", ""]
+    )
+  end
+
+end
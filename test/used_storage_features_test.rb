@@ -0,0 +1,73 @@
+#!/usr/bin/env rspec
+
+require_relative "spec_helper"
+require "storage/used_storage_features"
+require "ostruct"
+
+
+describe Yast::StorageHelpers::UsedStorageFeatures do
+
+  subject(:used_features) { described_class.new(double("storage", getEfiBoot: false)) }
+
+  def volume(name, fs, mount)
+    OpenStruct.new(name: name, usedBy: [], encryption: ::Storage::ENC_NONE,
+      mount: mount, fs: fs, fstab_options: "", userdata: {})
+  end
+
+  let(:root) { volume("/dev/sda1", ::Storage::EXT4, "/") }
+  let(:home) { volume("/dev/sda2", ::Storage::EXT4, "/home") }
+  let(:data) { volume("/dev/sdb1", ::Storage::XFS, "/data") }
+
+  before do
+    allow(used_features).to receive(:storage_containers).and_return([])
+  end
+
+
+  it "counts the devices using each feature" do
+    allow(used_features).to receive(:storage_volumes).and_return([root, home, data])
+    expect(used_features.collect_features).to contain_exactly(:FT_EXT4, :FT_XFS)
+    expect(used_features.feature_counts).to eq(FT_EXT4: 2, FT_XFS: 1)
+  end
+
+
+  it "drops the features of removed devices" do
+    allow(used_features).to receive(:storage_volumes).and_return([root, data], [root])
+    used_features.collect_features
+    expect(used_features.collect_features).to eq([:FT_EXT4])
+  end
+
+
+  it "checks unchanged devices only once" do
+    allow(used_features).to receive(:storage_volumes).and_return([root])
+    expect(used_features).to receive(:collect_volume_features).once.and_call_original
+    used_features.collect_features
+    used_features.collect_features
+  end
+
+
+  it "checks changed devices again" do
+    changed = volume("/dev/sda1", ::Storage::XFS, "/")
+    allow(used_features).to receive(:storage_volumes).and_return([root], [changed])
+    used_features.collect_features
+    expect(used_features.collect_features).to eq([:FT_XFS])
+  end
+
+
+  it "keeps a partition and its btrfs volume apart" do
+    partition = volume("/dev/sda2", ::Storage::BTRFS, "")
+    partition.encryption = ::Storage::ENC_LUKS
+    btrfs = volume("/dev/sda2", ::Storage::BTRFS, "/")
+    btrfs.userdata = { "/" => "snapshots" }
+    allow(used_features).to receive(:storage_volumes).and_return([partition, btrfs])
+    expect(used_features).to receive(:collect_volume_features).twice.and_call_original
+
+    used_features.collect_features
+    expect(used_features.collect_features).to contain_exactly(
+      :FT_LUKS, :FT_BTRFS, :FT_BTRFS_ROOT, :FT_SNAPSHOTS
+    )
+    expect(used_features.feature_counts).to eq(
+      FT_LUKS: 1, FT_BTRFS: 1, FT_BTRFS_ROOT: 1, FT_SNAPSHOTS: 1
+    )
+  end
+
+end
@@ -0,0 +1,116 @@
+# encoding: utf-8
+
+# Copyright (c) 2016 SUSE LLC.
+#  All Rights Reserved.
+
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of version 2 or 3 of the GNU General
+#  Public License as published by the Free Software Foundation.
+
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.   See the
+#  GNU General Public License for more details.
+
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, contact SUSE LLC.
+
+#  To contact SUSE about this file by physical or electronic mail,
+#  you may find current contact information at www.suse.com
+
+# Times the storage functions on the system in tmp/ and writes the results
+# as YAML to the file given in STORAGE_BENCHMARK_RESULT. Started by
+# run_benchmark.rb, one y2base process per system so that the peak memory
+# is per system.
+
+require "yaml"
+
+module Yast
+  class StorageBenchmarkClient < Client
+
+    def main
+      Yast.import "Testsuite"
+
+      read = {
+        "probe"     => {
+          "architecture" => "x86_64",
+          "bios"         => [ { "lba_support" => true } ],
+          "cdrom"        => [],
+          "system"       => [ { "system" => "" } ]
+        },
+        "proc"      => {
+          "swaps"   => [],
+          "meminfo" => { "memtotal" => 256 * 1024 }
+        },
+        "sysconfig" => {
+          "storage"    => { "DEFAULT_FS" => "btrfs" },
+          "bootloader" => { "LOADER_TYPE" => "grub" },
+          "language"   => { "RC_LANG" => "en_US.UTF-8", "RC_LC_MESSAGES" => "" }
+        },
+        "target"    => {
+          "size"        => 0,
+          "string"      => nil,
+          "bash_output" => {},
+          "yast2"       => {},
+          "dir"         => []
+        }
+      }
+
+      Testsuite.Init([read, {}, read], nil)
+
+      Yast.import "Stage"
+      Yast.import "Storage"
+      Yast.import "StorageFields"
+      Yast.import "StorageProposal"
+
+      Stage.Set("initial")
+
+      @results = {}
+
+      measure("InitLibstorage") { Storage.InitLibstorage(false) }
+
+      StorageProposal.GetControlCfg()
+
+      target_map = measure("GetTargetMap") { Storage.GetTargetMap() }
+
+      prop = measure("get_inst_proposal") { StorageProposal.get_inst_proposal(target_map) }
+
+      if prop.fetch("ok", false)
+        measure("SetTargetMap") { Storage.SetTargetMap(prop.fetch("target", {})) }
+      end
+
+      fields = [ :device, :size, :format, :encrypted, :type, :fs_type, :label,
+                 :mount_point, :mount_by, :used_by ]
+      measure("StorageFields.Table") do
+        StorageFields.Table(fields, Storage.GetTargetMap(),
+                            fun_ref(StorageFields.method(:PredicateAll), "symbol (map, map)"))
+      end
+
+      Storage.FinishLibstorage
+
+      @results["peak_rss_k"] = peak_rss_k
+
+      File.write(ENV.fetch("STORAGE_BENCHMARK_RESULT", "benchmark.yml"), @results.to_yaml)
+
+      nil
+    end
+
+
+    def measure(name)
+      start = ::Time.now
+      ret = yield
+      @results[name] = ::Time.now - start
+      ret
+    end
+
+
+    # peak resident set size of the process (VmHWM) in KiB
+    def peak_rss_k
+      line = ::File.readlines("/proc/self/status").find { |l| l.start_with?("VmHWM:") }
+      line ? line.split[1].to_i : 0
+    end
+
+  end
+end
+
+Yast::StorageBenchmarkClient.new.main
@@ -0,0 +1,296 @@
+#!/usr/bin/env ruby
+# encoding: utf-8
+
+# Copyright (c) 2016 SUSE LLC.
+#  All Rights Reserved.
+
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of version 2 or 3 of the GNU General
+#  Public License as published by the Free Software Foundation.
+
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.   See the
+#  GNU General Public License for more details.
+
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, contact SUSE LLC.
+
+#  To contact SUSE about this file by physical or electronic mail,
+#  you may find current contact information at www.suse.com
+
+# Generates a synthetic system in the .info format used by libstorage in
+# test mode (see testsuite/data), e.g.
+#
+#   generate_system.rb --disks 64 --lvs 200 --raids 4 --multipath 2 \
+#     --windows 1 tmp
+#
+# The disks alternate between gpt and msdos labels. The first disks get a
+# Windows partition, then follow the physical volumes of one volume group
+# "bench" holding all logical volumes, the members of the RAID1 arrays and
+# finally disks with ordinary Linux partitions.
+
+require "optparse"
+require "fileutils"
+require "digest/md5"
+require "rexml/document"
+
+module StorageBenchmark
+  class SystemGenerator
+
+    CYL_SIZE_K = 255 * 63 * 512 / 1024
+    DISK_SIZE_K = 500 * 1024 * 1024
+
+    ID_NTFS = 0x07
+    ID_LINUX = 0x83
+    ID_LVM = 0x8e
+    ID_RAID = 0xfd
+
+    attr_reader :files
+
+    def initialize(disks: 1, lvs: 0, raids: 0, multipath: 0, windows: 0)
+      @disks = disks
+      @lvs = lvs
+      @raids = raids
+      @multipath = multipath
+      @windows = [windows, disks].min
+      @files = {}
+    end
+
+    # @return [Hash{String => String}] file name => content
+    def generate
+      @files = {}
+      free = []
+      pvs = []
+      mds = Hash.new { |h, k| h[k] = [] }
+
+      raid_members = [@raids * 2, @disks - @windows].min
+      pv_count = @lvs > 0 ? [[(@lvs + 31) / 32, 1].max, @disks - @windows - raid_members].min : 0
+
+      @disks.times do |i|
+        name = disk_name(i)
+        label = i.even? && i >= @windows ? "gpt" : "msdos"
+
+        if i < @windows
+          parts = [partition(name, 1, DISK_SIZE_K, fs_type: "ntfs-3g", id: ID_NTFS)]
+          free << windows_free(parts.first[:device])
+        elsif i < @windows + pv_count
+          parts = [partition(name, 1, DISK_SIZE_K, id: ID_LVM,
+                             used_by: ["lvm", "/dev/bench"])]
+          pvs.concat(parts)
+        elsif i < @windows + pv_count + raid_members
+          md = "/dev/md#{(i - @windows - pv_count) / 2}"
+          parts = [partition(name, 1, DISK_SIZE_K, id: ID_RAID, used_by: ["md", md])]
+          mds[md].concat(parts)
+        else
+          size_k = DISK_SIZE_K / 4
+          parts = (1..3).map do |nr|
+            partition(name, nr, size_k, fs_type: nr == 1 ? "xfs" : "ext4",
+                      id: ID_LINUX, start: (nr - 1) * size_k)
+          end
+        end
+
+        @files["disk_#{name}.info"] = disk(name, label, parts)
+      end
+
+      @files["lvmvg_bench.info"] = volume_group("bench", pvs) if !pvs.empty?
+      @files["md.info"] = md_arrays(mds) if !mds.empty?
+
+      @multipath.times do |i|
+        name = format("3600508b4000156d7%015x", i)
+        parts = [partition("mapper/#{name}", 1, DISK_SIZE_K, fs_type: "ext4",
+                           id: ID_LINUX, name: "#{name}-part1")]
+        @files["dmmultipath_#{name}.info"] = multipath(name, parts)
+      end
+
+      @files["free.info"] = xml("free", free.join) if !free.empty?
+
+      @files
+    end
+
+    def write(dir)
+      FileUtils.mkdir_p(dir)
+      generate.each do |file, content|
+        File.write(File.join(dir, file), content)
+      end
+    end
+
+    private
+
+    def disk_name(i)
+      suffix = ""
+      loop do
+        suffix.prepend(("a".ord + i % 26).chr)
+        i = i / 26 - 1
+        break if i < 0
+      end
+      "sd" + suffix
+    end
+
+    def cylinders(size_k)
+      (size_k + CYL_SIZE_K - 1) / CYL_SIZE_K
+    end
+
+    def partition(disk, nr, size_k, fs_type: nil, id: ID_LINUX, used_by: nil,
+                  start: 0, name: nil)
+      {
+        name:     name || "#{disk}#{nr}",
+        device:   "/dev/#{name ? "mapper/" + name : disk + nr.to_s}",
+        nr:       nr,
+        size_k:   size_k,
+        fs_type:  fs_type,
+        id:       id,
+        used_by:  used_by,
+        start:    cylinders(start),
+        length:   cylinders(size_k)
+      }
+    end
+
+    def partition_xml(part)
+      tag("partition",
+        tag("name", part[:name]) +
+        tag("device", part[:device]) +
+        tag("size_k", part[:size_k]) +
+        (part[:used_by] ?
+          tag("used_by", tag("type", part[:used_by][0]) + tag("device", part[:used_by][1])) : "") +
+        tag("numeric", true) +
+        tag("number", part[:nr]) +
+        (part[:fs_type] ? tag("fs_type", part[:fs_type]) : "") +
+        (part[:fs_type] ? tag("fs_uuid", uuid(part[:device])) : "") +
+        tag("region", tag("start", part[:start]) + tag("length", part[:length])) +
+        tag("partition_type", "primary") +
+        tag("partition_id", part[:id]))
+    end
+
+    def geometry(size_k)
+      tag("geometry",
+        tag("cylinders", cylinders(size_k)) + tag("heads", 255) + tag("sectors", 63))
+    end
+
+    def disk(name, label, parts)
+      xml("disk",
+        tag("name", name) +
+        tag("device", "/dev/#{name}") +
+        tag("size_k", DISK_SIZE_K) +
+        tag("range", 256) +
+        geometry(DISK_SIZE_K) +
+        tag("label", label) +
+        tag("max_primary", label == "gpt" ? 128 : 4) +
+        (label == "msdos" ? tag("ext_possible", true) + tag("max_logical", 255) : "") +
+        tag("transport", "SATA") +
+        parts.map { |part| partition_xml(part) }.join)
+    end
+
+    def multipath(name, parts)
+      xml("dmmultipath",
+        tag("name", "mapper/#{name}") +
+        tag("device", "/dev/mapper/#{name}") +
+        tag("size_k", DISK_SIZE_K) +
+        tag("range", 256) +
+        geometry(DISK_SIZE_K) +
+        tag("label", "gpt") +
+        tag("max_primary", 128) +
+        tag("vendor", "HP") +
+        tag("model", "HSV210") +
+        parts.map { |part| partition_xml(part) }.join)
+    end
+
+    def volume_group(name, pvs)
+      pe_size_k = 4096
+      pe_count = pvs.map { |pv| pv[:size_k] / pe_size_k }.reduce(0, :+)
+      lv_pe = @lvs > 0 ? [pe_count / @lvs, 1].max : 0
+      pe_free = pe_count - lv_pe * @lvs
+
+      lvs = (0...@lvs).map do |i|
+        tag("logical_volume",
+          tag("name", "lv#{i}") +
+          tag("device", "/dev/#{name}/lv#{i}") +
+          tag("size_k", lv_pe * pe_size_k) +
+          tag("numeric", false) +
+          tag("fs_type", i.even? ? "ext4" : "xfs") +
+          tag("fs_uuid", uuid("/dev/#{name}/lv#{i}")) +
+          tag("table_name", "#{name}-lv#{i}") +
+          tag("stripes", 1))
+      end
+
+      xml("volume_group",
+        tag("name", name) +
+        tag("device", "/dev/#{name}") +
+        tag("size_k", pe_count * pe_size_k) +
+        tag("pe_size_k", pe_size_k) +
+        tag("pe_count", pe_count) +
+        tag("pe_free", pe_free) +
+        pvs.map do |pv|
+          tag("physical_extent",
+            tag("device", pv[:device]) +
+            tag("pe_count", pv[:size_k] / pe_size_k) +
+            tag("pe_free", 0))
+        end.join +
+        lvs.join)
+    end
+
+    def md_arrays(mds)
+      xml("md_container",
+        mds.map do |device, members|
+          tag("md",
+            tag("name", File.basename(device)) +
+            tag("device", device) +
+            tag("size_k", members.map { |m| m[:size_k] }.min) +
+            tag("md_type", "raid1") +
+            tag("fs_type", "ext4") +
+            tag("fs_uuid", uuid(device)) +
+            members.map { |m| tag("devices", m[:device]) }.join)
+        end.join)
+    end
+
+    def windows_free(device)
+      tag("free",
+        tag("device", device) +
+        tag("resize_cached", true) +
+        tag("df_free_k", DISK_SIZE_K / 2) +
+        tag("resize_free_k", DISK_SIZE_K / 2) +
+        tag("used_k", DISK_SIZE_K / 4) +
+        tag("resize_ok", true) +
+        tag("content_cached", true) +
+        tag("windows", true) +
+        tag("efi", false) +
+        tag("home", false))
+    end
+
+    # deterministic uuid so generated systems are reproducible
+    def uuid(seed)
+      hex = Digest::MD5.hexdigest(seed)
+      [hex[0, 8], hex[8, 4], hex[12, 4], hex[16, 4], hex[20, 12]].join("-")
+    end
+
+    def tag(name, content)
+      "<#{name}>#{content}</#{name}>"
+    end
+
+    def xml(root, content)
+      out = ""
+      formatter = REXML::Formatters::Pretty.new(2)
+      formatter.compact = true
+      formatter.write(REXML::Document.new(tag(root, content)).root, out)
+      "<?xml version=\"1.0\"?>\n" + out + "\n"
+    end
+
+  end
+end
+
+
+if $0 == __FILE__
+  options = { disks: 1, lvs: 0, raids: 0, multipath: 0, windows: 0 }
+
+  parser = OptionParser.new do |opts|
+    opts.banner = "Usage: generate_system.rb [options] directory"
+    [:disks, :lvs, :raids, :multipath, :windows].each do |key|
+      opts.on("--#{key} N", Integer, "number of #{key}") { |n| options[key] = n }
+    end
+  end
+  parser.parse!
+
+  abort(parser.banner) if ARGV.size != 1
+
+  StorageBenchmark::SystemGenerator.new(**options).write(ARGV[0])
+end
@@ -0,0 +1,81 @@
+#!/usr/bin/env ruby
+# encoding: utf-8
+
+# Copyright (c) 2016 SUSE LLC.
+#  All Rights Reserved.
+
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of version 2 or 3 of the GNU General
+#  Public License as published by the Free Software Foundation.
+
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.   See the
+#  GNU General Public License for more details.
+
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, contact SUSE LLC.
+
+#  To contact SUSE about this file by physical or electronic mail,
+#  you may find current contact information at www.suse.com
+
+# Benchmarks GetTargetMap, get_inst_proposal, SetTargetMap and
+# StorageFields.Table on generated systems of growing size, e.g.
+#
+#   cd testsuite/benchmark
+#   ./run_benchmark.rb --sizes 1,8,64,256
+#
+# For size N the system has N disks, 4*N logical volumes, N/8 RAID1 arrays,
+# N/16 multipath devices and one Windows disk. Each size runs in its own
+# y2base process using libstorage in test mode.
+
+require "optparse"
+require "tmpdir"
+require "yaml"
+require_relative "generate_system"
+
+options = {
+  sizes:  [1, 8, 64],
+  y2base: "/usr/lib/YaST2/bin/y2base",
+  y2dir:  File.expand_path("../../src", __dir__)
+}
+
+OptionParser.new do |opts|
+  opts.banner = "Usage: run_benchmark.rb [options]"
+  opts.on("--sizes LIST", Array, "system sizes, default 1,8,64") do |list|
+    options[:sizes] = list.map(&:to_i)
+  end
+  opts.on("--y2base PATH", "y2base binary") { |path| options[:y2base] = path }
+  opts.on("--y2dir DIR", "Y2DIR with the modules to benchmark") { |dir| options[:y2dir] = dir }
+end.parse!
+
+COLUMNS = ["GetTargetMap", "get_inst_proposal", "SetTargetMap", "StorageFields.Table"]
+
+puts format("%6s %6s %6s" + " %20s" * COLUMNS.size + " %12s",
+            "size", "disks", "lvs", *COLUMNS, "peak RSS MiB")
+
+options[:sizes].each do |size|
+  generator = StorageBenchmark::SystemGenerator.new(disks: size, lvs: 4 * size,
+    raids: size / 8, multipath: size / 16, windows: 1)
+
+  Dir.mktmpdir("storage-benchmark") do |dir|
+    # libstorage in test mode reads the system from tmp/ of the cwd
+    generator.write(File.join(dir, "tmp"))
+    result_file = File.join(dir, "result.yml")
+
+    env = { "Y2DIR" => options[:y2dir], "STORAGE_BENCHMARK_RESULT" => result_file }
+    client = File.expand_path("benchmark_client.rb", __dir__)
+    ok = system(env, options[:y2base], client, "stdio", chdir: dir,
+                out: File::NULL, err: File::NULL)
+
+    if !ok || !File.exist?(result_file)
+      puts format("%6d failed", size)
+      next
+    end
+
+    result = YAML.load_file(result_file)
+    times = COLUMNS.map { |c| result[c] ? format("%.3f", result[c]) : "-" }
+    puts format("%6d %6d %6d" + " %20s" * COLUMNS.size + " %12.1f",
+                size, size, 4 * size, *times, result["peak_rss_k"] / 1024.0)
+  end
+end